@@ -0,0 +1,661 @@
+// Host-side microbenchmarks for the watchface's helper modules.
+//
+// Each benchmark runs the code the watch used to run next to its
+// replacement over the same inputs, checks that the results agree with
+// a reference, and reports the time per call. Run with no arguments for
+// every benchmark, or name the ones to run.
+
+#include <math.h>
+#include <time.h>
+
+#include "../src/calendar.h"
+#include "../src/format.h"
+#include "../src/units.h"
+#include "../src/weather.h"
+
+#undef time
+
+typedef struct {
+  const char *name;
+  int (*run)(void);
+} Benchmark;
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void set_tz(const char *tz)
+{
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+// Calendar
+
+typedef struct {
+  uint8_t dayOfMonth[CALENDAR_DAYS];
+  int todayIndex;
+} CalendarCells;
+
+// The calendar as update_date used to build it: strftime("%w") parsed
+// back with atoi, then localtime and strftime("%e") for every cell,
+// stepping a fixed 86400 seconds from the current time.
+static void legacy_calendar(time_t now, bool mondayFirst, CalendarCells *cells)
+{
+  struct tm *tick_time = localtime(&now);
+  char dayOfWeekString[2];
+  strftime(dayOfWeekString, sizeof(dayOfWeekString), "%w", tick_time);
+  int dayOfWeek = atoi(dayOfWeekString);
+  if (mondayFirst)
+  {
+    dayOfWeek = dayOfWeek - 1;
+  }
+
+  time_t calendarDate = now - (86400 * dayOfWeek);
+  if (mondayFirst && (dayOfWeek == -1))
+  {
+    calendarDate -= (86400 * 7);
+    dayOfWeek = 6;
+  }
+
+  struct tm *calendarDate_time = localtime(&calendarDate);
+  char calendarDayBuffer[3];
+  for (int dayLoop = 0; dayLoop < CALENDAR_DAYS; dayLoop++)
+  {
+    strftime(calendarDayBuffer, sizeof(calendarDayBuffer), "%e", calendarDate_time);
+    cells->dayOfMonth[dayLoop] = atoi(calendarDayBuffer);
+    calendarDate += 86400;
+    calendarDate_time = localtime(&calendarDate);
+  }
+  cells->todayIndex = dayOfWeek;
+}
+
+// Reference: let mktime normalise each cell's date at midday, where no
+// daylight saving transition can move it to another day.
+static void reference_calendar(const struct tm *today, bool mondayFirst, CalendarCells *cells)
+{
+  int offset = mondayFirst ? (today->tm_wday + 6) % 7 : today->tm_wday;
+  for (int cell = 0; cell < CALENDAR_DAYS; cell++)
+  {
+    struct tm date = *today;
+    date.tm_mday += cell - offset;
+    date.tm_hour = 12;
+    date.tm_min = 0;
+    date.tm_sec = 0;
+    date.tm_isdst = -1;
+    mktime(&date);
+    cells->dayOfMonth[cell] = date.tm_mday;
+  }
+  cells->todayIndex = offset;
+}
+
+static bool cells_match(const CalendarCells *a, const uint8_t *dayOfMonth, int todayIndex)
+{
+  return (a->todayIndex == todayIndex) && (memcmp(a->dayOfMonth, dayOfMonth, CALENDAR_DAYS) == 0);
+}
+
+static int bench_calendar(void)
+{
+  // Shortly after midnight is when stepping by 86400 seconds across a
+  // daylight saving change lands on the wrong day.
+  static const char *zones[] = { "UTC", "America/New_York", "Europe/Berlin", "Australia/Sydney" };
+  const int firstYear = 1970;
+  const int lastYear = 2099;
+  int failures = 0;
+
+  printf("calendar: every day %d-%d at 00:30, Sunday and Monday first\n", firstYear, lastYear);
+  printf("  %-18s %8s %12s %12s %12s %8s %8s\n",
+         "zone", "days", "legacy ns", "build ns", "update ns", "legacy!", "module!");
+
+  for (size_t zone = 0; zone < sizeof(zones) / sizeof(zones[0]); zone++)
+  {
+    set_tz(zones[zone]);
+    int32_t firstDay = calendar_days_from_civil(firstYear, 1, 1);
+    int32_t lastDay = calendar_days_from_civil(lastYear, 12, 31);
+    int days = lastDay - firstDay + 1;
+
+    time_t *times = malloc(sizeof(time_t) * days);
+    struct tm *dates = malloc(sizeof(struct tm) * days);
+    for (int i = 0; i < days; i++)
+    {
+      int year, month, day;
+      calendar_civil_from_days(firstDay + i, &year, &month, &day);
+      struct tm date = { .tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day,
+                         .tm_hour = 0, .tm_min = 30, .tm_isdst = -1 };
+      times[i] = mktime(&date);
+      dates[i] = date;
+    }
+
+    double legacyNs = 0, buildNs = 0, updateNs = 0;
+    int legacyErrors = 0, moduleErrors = 0;
+    for (int mondayFirst = 0; mondayFirst <= 1; mondayFirst++)
+    {
+      CalendarCells cells, reference;
+      CalendarGrid grid;
+      memset(&grid, 0, sizeof(grid));
+
+      double start = now_ns();
+      for (int i = 0; i < days; i++)
+      {
+        legacy_calendar(times[i], mondayFirst, &cells);
+      }
+      legacyNs += now_ns() - start;
+
+      start = now_ns();
+      for (int i = 0; i < days; i++)
+      {
+        calendar_build(&grid, firstDay + i, mondayFirst);
+      }
+      buildNs += now_ns() - start;
+
+      memset(&grid, 0, sizeof(grid));
+      start = now_ns();
+      for (int i = 0; i < days; i++)
+      {
+        calendar_update(&grid, firstDay + i, mondayFirst);
+      }
+      updateNs += now_ns() - start;
+
+      // Check both against the reference, walking the incremental path
+      // the way the watch does at midnight.
+      memset(&grid, 0, sizeof(grid));
+      for (int i = 0; i < days; i++)
+      {
+        reference_calendar(&dates[i], mondayFirst, &reference);
+        legacy_calendar(times[i], mondayFirst, &cells);
+        if (!cells_match(&reference, cells.dayOfMonth, cells.todayIndex))
+        {
+          legacyErrors++;
+        }
+
+        calendar_update(&grid, firstDay + i, mondayFirst);
+        char weekNumber[3];
+        strftime(weekNumber, sizeof(weekNumber), mondayFirst ? "%W" : "%U", &dates[i]);
+        if (!cells_match(&reference, grid.dayOfMonth, grid.todayIndex) ||
+            (grid.weekNumber != atoi(weekNumber)) ||
+            (calendar_week_number(dates[i].tm_yday, dates[i].tm_wday, mondayFirst) != grid.weekNumber))
+        {
+          moduleErrors++;
+        }
+      }
+    }
+
+    printf("  %-18s %8d %12.1f %12.1f %12.1f %8d %8d\n",
+           zones[zone], days,
+           legacyNs / (2 * days), buildNs / (2 * days), updateNs / (2 * days),
+           legacyErrors, moduleErrors);
+    failures += moduleErrors;
+    free(times);
+    free(dates);
+  }
+  printf("  legacy! counts grids the old update_date got wrong; module! must be 0\n");
+  return failures;
+}
+
+// Formatting
+
+// The display text as update_time, update_date, update_weather,
+// update_forecast_line and update_battery_state used to build it, with
+// snprintf, strftime, strcpy and strcat.
+static void legacy_time(const struct tm *tick_time, bool clock24h, char *buffer)
+{
+  strftime(buffer, sizeof("00:00"), clock24h ? "%H:%M" : "%l:%M", tick_time);
+}
+
+static void legacy_date(const struct tm *tick_time, char *buffer, size_t size)
+{
+  strftime(buffer, size, "%A, %b %e", tick_time);
+}
+
+// update_weather's wind direction if chain, comparing against doubles.
+static const char *legacy_compass8(int windDirection_deg)
+{
+  if (windDirection_deg >= 337.5 || windDirection_deg <= 22.5)
+  {
+    return "N";
+  }
+  else if (windDirection_deg < 67.5)
+  {
+    return "NE";
+  }
+  else if (windDirection_deg <= 112.5)
+  {
+    return "E";
+  }
+  else if (windDirection_deg < 157.5)
+  {
+    return "SE";
+  }
+  else if (windDirection_deg <= 202.5)
+  {
+    return "S";
+  }
+  else if (windDirection_deg < 247.5)
+  {
+    return "SW";
+  }
+  else if (windDirection_deg <= 292.5)
+  {
+    return "W";
+  }
+  else
+  {
+    return "NW";
+  }
+}
+
+static void legacy_weather(int temperature, bool fahrenheit, int windSpeed, int windDirection_deg,
+                           uint8_t conditions, char *buffer, size_t size)
+{
+  char currentTemperatureString[10];
+  snprintf(currentTemperatureString, sizeof(currentTemperatureString), fahrenheit ? "%dF" : "%dC", temperature);
+  const char *windDirectionString = legacy_compass8(windDirection_deg);
+  snprintf(buffer, size, "%s %d%s %s", currentTemperatureString, windSpeed, windDirectionString,
+           weather_description(conditions));
+}
+
+static void legacy_forecast(const struct tm *date, int low, int high, bool fahrenheit, uint8_t conditions,
+                            char *label, size_t labelSize, char *buffer, size_t size)
+{
+  strftime(label, labelSize, "%a", date);
+  label[2] = 0;
+  snprintf(buffer, size, fahrenheit ? "%d/%dF %s" : "%d/%dC %s", low, high, weather_summary(conditions));
+}
+
+static void legacy_battery(int percent, bool charging, char *buffer, size_t size)
+{
+  snprintf(buffer, size, " %i%%", percent);
+  if (charging)
+  {
+    strcat(buffer, "+");
+  }
+}
+
+// The same text built with the format module, as main.c does now.
+static void module_time(const struct tm *tick_time, bool clock24h, char *buffer, size_t size)
+{
+  FormatBuffer text;
+  format_begin(&text, buffer, size);
+  int hour = tick_time->tm_hour;
+  if (!clock24h)
+  {
+    hour = (hour % 12) ? hour % 12 : 12;
+  }
+  format_two_digits(&text, hour, clock24h ? '0' : ' ');
+  format_char(&text, ':');
+  format_two_digits(&text, tick_time->tm_min, '0');
+}
+
+static void module_date(const struct tm *tick_time, char *buffer, size_t size)
+{
+  FormatBuffer text;
+  format_begin(&text, buffer, size);
+  format_string(&text, format_day_name(tick_time->tm_wday));
+  format_string(&text, ", ");
+  format_string(&text, format_month_abbreviation(tick_time->tm_mon));
+  format_char(&text, ' ');
+  format_two_digits(&text, tick_time->tm_mday, ' ');
+}
+
+static void module_weather(int temperature, bool fahrenheit, int windSpeed, int windDirection_deg,
+                           uint8_t conditions, char *buffer, size_t size)
+{
+  FormatBuffer text;
+  format_begin(&text, buffer, size);
+  format_int(&text, temperature);
+  format_char(&text, fahrenheit ? 'F' : 'C');
+  format_char(&text, ' ');
+  format_int(&text, windSpeed);
+  format_string(&text, units_compass8(windDirection_deg));
+  format_char(&text, ' ');
+  format_string(&text, weather_description(conditions));
+}
+
+static void module_forecast(const struct tm *date, int low, int high, bool fahrenheit, uint8_t conditions,
+                            char *label, size_t labelSize, char *buffer, size_t size)
+{
+  FormatBuffer text;
+  format_begin(&text, label, labelSize);
+  format_prefix(&text, format_day_name(date->tm_wday), 2);
+  format_begin(&text, buffer, size);
+  format_int(&text, low);
+  format_char(&text, '/');
+  format_int(&text, high);
+  format_char(&text, fahrenheit ? 'F' : 'C');
+  format_char(&text, ' ');
+  format_string(&text, weather_summary(conditions));
+}
+
+static void module_battery(int percent, bool charging, char *buffer, size_t size)
+{
+  FormatBuffer text;
+  format_begin(&text, buffer, size);
+  format_char(&text, ' ');
+  format_int(&text, percent);
+  format_char(&text, '%');
+  if (charging)
+  {
+    format_char(&text, '+');
+  }
+}
+
+typedef struct {
+  double legacyNs;
+  double moduleNs;
+  int cases;
+  int mismatches;
+} FormatResult;
+
+static void print_format_result(const char *name, const FormatResult *result)
+{
+  printf("  %-10s %10d %12.1f %12.1f %8d\n", name, result->cases,
+         result->legacyNs / result->cases, result->moduleNs / result->cases, result->mismatches);
+}
+
+// Times one function over every case, then the other, then compares
+// their text case by case.
+#define FORMAT_CASES(result, count, setup, legacyCall, moduleCall)      \
+  do {                                                                  \
+    char legacyText[64], moduleText[64];                                \
+    (result).cases = (count);                                           \
+    double start = now_ns();                                            \
+    for (int i = 0; i < (count); i++) { setup; legacyCall; }            \
+    (result).legacyNs = now_ns() - start;                               \
+    start = now_ns();                                                   \
+    for (int i = 0; i < (count); i++) { setup; moduleCall; }            \
+    (result).moduleNs = now_ns() - start;                               \
+    (result).mismatches = 0;                                            \
+    for (int i = 0; i < (count); i++)                                   \
+    {                                                                   \
+      setup;                                                            \
+      legacyCall;                                                       \
+      moduleCall;                                                       \
+      (result).mismatches += (strcmp(legacyText, moduleText) != 0);     \
+    }                                                                   \
+  } while (0)
+
+static int bench_format(void)
+{
+  set_tz("UTC");
+  const int firstYear = 2000;
+  const int lastYear = 2099;
+  int32_t firstDay = calendar_days_from_civil(firstYear, 1, 1);
+  int days = calendar_days_from_civil(lastYear, 12, 31) - firstDay + 1;
+  FormatResult time, date, weather, forecast, battery;
+
+  printf("format: every minute (12 and 24 hour), every day %d-%d, weather lines for -60..60 degrees,\n"
+         "        0..98 wind speed, 0..360 degrees wind, forecasts for -40..40 pairs, battery 0..100%%\n",
+         firstYear, lastYear);
+  printf("  %-10s %10s %12s %12s %8s\n", "text", "cases", "legacy ns", "module ns", "differ!");
+
+  struct tm tick_time;
+  memset(&tick_time, 0, sizeof(tick_time));
+
+  FORMAT_CASES(time, 2 * 24 * 60,
+               (tick_time.tm_hour = i / 60 % 24, tick_time.tm_min = i % 60),
+               legacy_time(&tick_time, i >= 24 * 60, legacyText),
+               module_time(&tick_time, i >= 24 * 60, moduleText, 6));
+  print_format_result("time", &time);
+
+  int year, month, day;
+  FORMAT_CASES(date, days,
+               (calendar_civil_from_days(firstDay + i, &year, &month, &day),
+                tick_time.tm_year = year - 1900, tick_time.tm_mon = month - 1, tick_time.tm_mday = day,
+                tick_time.tm_wday = calendar_day_of_week(firstDay + i)),
+               legacy_date(&tick_time, legacyText, 20),
+               module_date(&tick_time, moduleText, 20));
+  print_format_result("date", &date);
+
+  // Temperature, wind speed and direction; the condition moves on with
+  // the direction so every description is used.
+  FORMAT_CASES(weather, 121 * 15 * 361,
+               (void)0,
+               legacy_weather(i / (15 * 361) - 60, i & 1, i / 361 % 15 * 7, i % 361, i % 97,
+                              legacyText, sizeof(legacyText)),
+               module_weather(i / (15 * 361) - 60, i & 1, i / 361 % 15 * 7, i % 361, i % 97,
+                              moduleText, sizeof(moduleText)));
+  print_format_result("weather", &weather);
+
+  char legacyLabel[8], moduleLabel[8];
+  FORMAT_CASES(forecast, 81 * 81 * 7,
+               (tick_time.tm_wday = i % 7),
+               legacy_forecast(&tick_time, i / (81 * 7) - 40, i / 7 % 81 - 40, i & 1, i % 97,
+                               legacyLabel, sizeof(legacyLabel), legacyText, sizeof(legacyText)),
+               (module_forecast(&tick_time, i / (81 * 7) - 40, i / 7 % 81 - 40, i & 1, i % 97,
+                                moduleLabel, sizeof(moduleLabel), moduleText, sizeof(moduleText)),
+                forecast.mismatches += (strcmp(legacyLabel, moduleLabel) != 0)));
+  print_format_result("forecast", &forecast);
+
+  FORMAT_CASES(battery, 2 * 101,
+               (void)0,
+               legacy_battery(i / 2, i & 1, legacyText, 8),
+               module_battery(i / 2, i & 1, moduleText, 8));
+  print_format_result("battery", &battery);
+
+  printf("  differ! counts text the format module builds differently; must be 0\n");
+  return time.mismatches + date.mismatches + weather.mismatches + forecast.mismatches + battery.mismatches;
+}
+
+// Units
+
+// The conversions update_weather used to make on every call, as they were.
+static int legacy_fahrenheit(int temp_celsius)
+{
+  return ((temp_celsius * 9 / 5) + 32);
+}
+
+static int legacy_wind_speed(int windSpeed_metersPerSecond, int units)
+{
+  switch(units)
+  {
+    case WINDSPEED_UNITS_KNOTS:
+      return (windSpeed_metersPerSecond * 194384 / 100000);
+    case WINDSPEED_UNITS_MPH:
+      return (windSpeed_metersPerSecond * 223694 / 100000);
+    case WINDSPEED_UNITS_KPH:
+      return (windSpeed_metersPerSecond * 36 / 10);
+  }
+  return windSpeed_metersPerSecond;
+}
+
+// References in floating point, rounded half away from zero.
+static int reference_temperature(int temp_celsius, int units)
+{
+  return (units == TEMPERATURE_UNITS_F) ? (int)lround(temp_celsius * 1.8 + 32) : temp_celsius;
+}
+
+static int reference_wind_speed(int windSpeed_metersPerSecond, int units)
+{
+  switch(units)
+  {
+    case WINDSPEED_UNITS_KNOTS:
+      return (int)lround(windSpeed_metersPerSecond * 3600.0 / 1852.0);
+    case WINDSPEED_UNITS_MPH:
+      return (int)lround(windSpeed_metersPerSecond * 3600.0 / 1609.344);
+    case WINDSPEED_UNITS_KPH:
+      return (int)lround(windSpeed_metersPerSecond * 3.6);
+  }
+  // Empirical Beaufort scale, v = 0.836 B^(3/2) m/s.
+  int force = (int)lround(pow(windSpeed_metersPerSecond / 0.836, 2.0 / 3.0));
+  return force > 12 ? 12 : force;
+}
+
+static int reference_compass(int direction_deg, int points)
+{
+  double degrees = fmod(direction_deg, 360.0);
+  if (degrees < 0)
+  {
+    degrees += 360.0;
+  }
+  return (int)floor(degrees / (360.0 / points) + 0.5) % points;
+}
+
+static const char *const s_referenceCompass16[16] = {
+  "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE", "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW",
+};
+
+typedef struct {
+  const char *name;
+  int cases;
+  double legacyNs;
+  double moduleNs;
+  int legacyErrors;
+  int moduleErrors;
+} UnitsResult;
+
+static void print_units_result(const UnitsResult *result)
+{
+  if (result->legacyNs > 0)
+  {
+    printf("  %-10s %8d %12.2f %12.2f %8d %8d\n", result->name, result->cases,
+           result->legacyNs / result->cases, result->moduleNs / result->cases,
+           result->legacyErrors, result->moduleErrors);
+  }
+  else
+  {
+    printf("  %-10s %8d %12s %12.2f %8s %8d\n", result->name, result->cases, "-",
+           result->moduleNs / result->cases, "-", result->moduleErrors);
+  }
+}
+
+// Sums results so the timed loops can't be optimized away.
+static volatile int s_unitsSink;
+
+static int bench_units(void)
+{
+  const int minTemperature = INT16_MIN, maxTemperature = INT16_MAX;
+  const int maxWindSpeed = INT16_MAX;
+  const int minDirection = -1080, maxDirection = 1080;
+  int failures = 0;
+
+  printf("units: every int16 temperature, wind speeds 0..%d, directions %d..%d\n",
+         maxWindSpeed, minDirection, maxDirection);
+  printf("  %-10s %8s %12s %12s %8s %8s\n", "unit", "cases", "legacy ns", "module ns", "legacy!", "module!");
+
+  UnitsResult fahrenheit = { "F", maxTemperature - minTemperature + 1 };
+  int sum = 0;
+  double start = now_ns();
+  for (int c = minTemperature; c <= maxTemperature; c++)
+  {
+    sum += legacy_fahrenheit(c);
+  }
+  fahrenheit.legacyNs = now_ns() - start;
+  start = now_ns();
+  for (int c = minTemperature; c <= maxTemperature; c++)
+  {
+    sum += units_temperature(c, TEMPERATURE_UNITS_F);
+  }
+  fahrenheit.moduleNs = now_ns() - start;
+  for (int c = minTemperature; c <= maxTemperature; c++)
+  {
+    int reference = reference_temperature(c, TEMPERATURE_UNITS_F);
+    fahrenheit.legacyErrors += (legacy_fahrenheit(c) != reference);
+    fahrenheit.moduleErrors += (units_temperature(c, TEMPERATURE_UNITS_F) != reference);
+    failures += (units_temperature(c, TEMPERATURE_UNITS_C) != c);
+  }
+  print_units_result(&fahrenheit);
+  failures += fahrenheit.moduleErrors;
+
+  static const char *windNames[] = { "knots", "mph", "kph", "Beaufort" };
+  for (int units = WINDSPEED_UNITS_KNOTS; units <= WINDSPEED_UNITS_BEAUFORT; units++)
+  {
+    UnitsResult wind = { windNames[units], maxWindSpeed + 1 };
+    if (units != WINDSPEED_UNITS_BEAUFORT)
+    {
+      start = now_ns();
+      for (int speed = 0; speed <= maxWindSpeed; speed++)
+      {
+        sum += legacy_wind_speed(speed, units);
+      }
+      wind.legacyNs = now_ns() - start;
+    }
+    start = now_ns();
+    for (int speed = 0; speed <= maxWindSpeed; speed++)
+    {
+      sum += units_wind_speed(speed, units);
+    }
+    wind.moduleNs = now_ns() - start;
+    for (int speed = 0; speed <= maxWindSpeed; speed++)
+    {
+      int reference = reference_wind_speed(speed, units);
+      wind.legacyErrors += (units != WINDSPEED_UNITS_BEAUFORT) && (legacy_wind_speed(speed, units) != reference);
+      wind.moduleErrors += (units_wind_speed(speed, units) != reference);
+    }
+    print_units_result(&wind);
+    failures += wind.moduleErrors;
+  }
+
+  // The 8 point compass against update_weather's old if chain over the
+  // directions the phone sends, then the module alone over several
+  // turns either way.
+  UnitsResult compass8 = { "8 points", 361 };
+  start = now_ns();
+  for (int direction = 0; direction <= 360; direction++)
+  {
+    sum += legacy_compass8(direction)[0];
+  }
+  compass8.legacyNs = now_ns() - start;
+  start = now_ns();
+  for (int direction = 0; direction <= 360; direction++)
+  {
+    sum += units_compass8(direction)[0];
+  }
+  compass8.moduleNs = now_ns() - start;
+  for (int direction = minDirection; direction <= maxDirection; direction++)
+  {
+    const char *reference = s_referenceCompass16[2 * reference_compass(direction, 8)];
+    if ((direction >= 0) && (direction <= 360))
+    {
+      compass8.legacyErrors += (strcmp(legacy_compass8(direction), reference) != 0);
+    }
+    compass8.moduleErrors += (strcmp(units_compass8(direction), reference) != 0);
+  }
+  print_units_result(&compass8);
+  failures += compass8.moduleErrors;
+
+  UnitsResult compass16 = { "16 points", maxDirection - minDirection + 1 };
+  start = now_ns();
+  for (int direction = minDirection; direction <= maxDirection; direction++)
+  {
+    sum += units_compass16(direction)[0];
+  }
+  compass16.moduleNs = now_ns() - start;
+  for (int direction = minDirection; direction <= maxDirection; direction++)
+  {
+    compass16.moduleErrors += (strcmp(units_compass16(direction),
+                                      s_referenceCompass16[reference_compass(direction, 16)]) != 0);
+  }
+  print_units_result(&compass16);
+  failures += compass16.moduleErrors;
+
+  s_unitsSink = sum;
+  printf("  legacy! counts values the old code didn't round to the nearest; module! must be 0\n");
+  return failures;
+}
+
+static const Benchmark s_benchmarks[] = {
+  { "calendar", bench_calendar },
+  { "format", bench_format },
+  { "units", bench_units },
+};
+
+int main(int argc, char **argv)
+{
+  int failures = 0;
+  for (size_t i = 0; i < sizeof(s_benchmarks) / sizeof(s_benchmarks[0]); i++)
+  {
+    bool selected = (argc < 2);
+    for (int arg = 1; arg < argc; arg++)
+    {
+      selected |= (strcmp(argv[arg], s_benchmarks[i].name) == 0);
+    }
+    if (selected)
+    {
+      failures += s_benchmarks[i].run();
+    }
+  }
+  return failures ? 1 : 0;
+}
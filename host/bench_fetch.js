@@ -0,0 +1,376 @@
+// Benchmark of the weather fetch in src/weatherStream.js, run with node.
+//
+// Runs the phone's side of a day of weather refreshes, one every 30
+// minutes as the watch asks, against canned OpenWeatherMap documents:
+// once with the fetch the phone used to run (three documents in Kelvin,
+// every part on every refresh) and once with weatherStream.js as it is.
+// Reports the bytes downloaded and the JS time per refresh, and fails if
+// the two send the watch different current weather, or different
+// forecasts on a refresh where both fetched everything.
+
+"use strict";
+
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+var REFRESH_MINUTES = 30;
+var REFRESHES = 48;
+var PASSES = 200;
+var START_MS = 1425254400000; // Monday 2015-03-02 00:00 UTC, as the sim.
+var LOCATION = { latitude: 51.5074, longitude: -0.1278 };
+
+// Deterministic weather, in hundredths of a degree C, never on a half
+// degree so rounding from Kelvin and from metric agree.
+function hash(value) {
+  var x = Math.imul(value | 0, 2654435761) >>> 0;
+  x ^= x >>> 15;
+  return x % 1000;
+}
+
+function celsius(seed) {
+  var hundredths = 500 + hash(seed) * 2;
+  return (hundredths % 100 === 50 ? hundredths + 1 : hundredths) / 100;
+}
+
+function kelvin(value) {
+  return Math.round((value + 273.15) * 100) / 100;
+}
+
+// Documents as OpenWeatherMap's 2.5 API returns them, field for field,
+// in Kelvin unless units=metric.
+function weatherEntry(seed) {
+  var ids = [800, 801, 802, 803, 500, 501, 600, 701];
+  var id = ids[hash(seed + 3) % ids.length];
+  return [{ id: id, main: "Clouds", description: "broken clouds", icon: "04d" }];
+}
+
+function currentBlock(hour, units) {
+  return {
+    dt: hour * 3600 + 600, sunrise: 1425277967, sunset: 1425317640, temp: units(celsius(hour)),
+    feels_like: units(celsius(hour) - 2.3), pressure: 1016, humidity: 81, dew_point: units(4.02), uvi: 0.46,
+    clouds: 75, visibility: 10000, wind_speed: hash(hour + 1) % 12, wind_deg: hash(hour + 2) % 360,
+    weather: weatherEntry(hour)
+  };
+}
+
+function hourlyBlock(hour, units) {
+  var hours = [];
+  for (var h = 0; h < 48; h++) {
+    hours.push({
+      dt: (hour + h) * 3600, temp: units(celsius(hour + h)), feels_like: units(celsius(hour + h) - 2.3),
+      pressure: 1016, humidity: 81, dew_point: units(4.02), uvi: 0, clouds: 75, visibility: 10000,
+      wind_speed: 4.12, wind_deg: 230, wind_gust: 8.2, weather: weatherEntry(hour + h), pop: 0.12
+    });
+  }
+  return hours;
+}
+
+function dailyTemperatures(day, units) {
+  var low = celsius(day * 7);
+  var high = low + 4 + hash(day) % 8;
+  return {
+    day: units(high - 1), min: units(low), max: units(high), night: units(low + 1), eve: units(high - 2),
+    morn: units(low + 0.5)
+  };
+}
+
+function oneCallDaily(day0, units) {
+  var days = [];
+  for (var d = 0; d < 8; d++) {
+    var day = day0 + d;
+    days.push({
+      dt: day * 86400 + 43200, sunrise: day * 86400 + 23567, sunset: day * 86400 + 63240,
+      moonrise: day * 86400 + 41820, moonset: day * 86400 + 12060, moon_phase: 0.41,
+      temp: dailyTemperatures(day, units),
+      feels_like: { day: units(8.1), night: units(3.2), eve: units(6.4), morn: units(2.9) },
+      pressure: 1016, humidity: 81, dew_point: units(4.02), wind_speed: 5.2, wind_deg: 230, wind_gust: 11.3,
+      weather: weatherEntry(day + 7), clouds: 75, pop: 0.42, rain: 1.21, uvi: 1.6
+    });
+  }
+  return days;
+}
+
+function forecastDaily(day0) {
+  var list = [];
+  for (var d = 0; d < 7; d++) {
+    var day = day0 + d;
+    list.push({
+      dt: day * 86400 + 43200, sunrise: day * 86400 + 23567, sunset: day * 86400 + 63240,
+      temp: dailyTemperatures(day, kelvin),
+      feels_like: { day: kelvin(8.1), night: kelvin(3.2), eve: kelvin(6.4), morn: kelvin(2.9) },
+      pressure: 1016, humidity: 81, weather: weatherEntry(day + 7), speed: 5.2, deg: 230, gust: 11.3,
+      clouds: 75, pop: 0.42, rain: 1.21
+    });
+  }
+  return {
+    city: { id: 2643743, name: "London", coord: { lon: -0.1278, lat: 51.5074 }, country: "GB",
+            population: 1000000, timezone: 0 },
+    cod: "200", message: 0.0585, cnt: list.length, list: list
+  };
+}
+
+function currentWeather(hour) {
+  var current = currentBlock(hour, kelvin);
+  return {
+    coord: { lon: -0.13, lat: 51.51 }, weather: current.weather, base: "stations",
+    main: { temp: current.temp, feels_like: current.feels_like, temp_min: kelvin(celsius(hour) - 1),
+            temp_max: kelvin(celsius(hour) + 1), pressure: 1016, humidity: 81 },
+    visibility: 10000, wind: { speed: current.wind_speed, deg: current.wind_deg }, clouds: { all: 75 },
+    dt: current.dt, sys: { type: 1, id: 1414, country: "GB", sunrise: 1425277967, sunset: 1425317640 },
+    timezone: 0, id: 2643743, name: "London", cod: 200
+  };
+}
+
+function document(url, nowMs) {
+  var hour = Math.floor(nowMs / 3600000);
+  var day = Math.floor(nowMs / 86400000);
+  var query = {};
+  url.split("?")[1].split("&").forEach(function(pair) {
+    var parts = pair.split("=");
+    query[parts[0]] = parts[1];
+  });
+  if (url.indexOf("/weather?") >= 0) {
+    return currentWeather(hour);
+  }
+  if (url.indexOf("/forecast/daily?") >= 0) {
+    return forecastDaily(day);
+  }
+  var units = query.units === "metric" ? function(value) { return Math.round(value * 100) / 100; } : kelvin;
+  var excluded = (query.exclude || "").split(",");
+  var json = { lat: 51.51, lon: -0.13, timezone: "Europe/London", timezone_offset: 0 };
+  if (excluded.indexOf("current") < 0) {
+    json.current = currentBlock(hour, units);
+  }
+  if (excluded.indexOf("hourly") < 0) {
+    json.hourly = hourlyBlock(hour, units);
+  }
+  if (excluded.indexOf("daily") < 0) {
+    json.daily = oneCallDaily(day, units);
+  }
+  return json;
+}
+
+// A phone to run weatherStream.js in: a fake clock, localStorage, a
+// location fix and XMLHttpRequest answering at once from the documents
+// above, which are made before the timed passes.
+function makePhone(source) {
+  var phone = { nowMs: START_MS, storage: {}, bytes: 0, requests: 0, sent: [], documents: {} };
+  var sandbox = {
+    console: { log: function() {} },
+    setTimeout: function() {},
+    localStorage: {
+      getItem: function(key) { return key in phone.storage ? phone.storage[key] : null; },
+      setItem: function(key, value) { phone.storage[key] = String(value); }
+    },
+    navigator: { geolocation: { getCurrentPosition: function(success) { success({ coords: LOCATION }); } } },
+    Pebble: {
+      addEventListener: function() {},
+      openURL: function() {},
+      sendAppMessage: function(dictionary, success) {
+        phone.sent.push(dictionary);
+        success({});
+      }
+    },
+    XMLHttpRequest: function() {
+      var xhr = this;
+      xhr.open = function(type, url) { xhr.url = url; };
+      xhr.send = function() {
+        var key = phone.nowMs + " " + xhr.url;
+        if (!(key in phone.documents)) {
+          phone.documents[key] = JSON.stringify(document(xhr.url, phone.nowMs));
+        }
+        xhr.responseText = phone.documents[key];
+        phone.requests++;
+        phone.bytes += xhr.url.length + xhr.responseText.length;
+        xhr.onload.call(xhr);
+      };
+    }
+  };
+  phone.context = vm.createContext(sandbox);
+  vm.runInContext(source, phone.context);
+  vm.runInContext("Date.now = function() { return __phone.nowMs; };", phone.context);
+  phone.context.__phone = phone;
+  return phone;
+}
+
+// One day of refreshes. Returns the JS time in ms.
+function runDay(phone) {
+  phone.storage = {};
+  phone.sent = [];
+  phone.bytes = 0;
+  phone.requests = 0;
+  var elapsed = 0;
+  for (var refresh = 0; refresh < REFRESHES; refresh++) {
+    phone.nowMs = START_MS + refresh * REFRESH_MINUTES * 60000;
+    var started = process.hrtime.bigint();
+    phone.context.getWeather(true);
+    elapsed += Number(process.hrtime.bigint() - started) / 1e6;
+  }
+  return elapsed;
+}
+
+// The fetch as weatherStream.js used to run it: the whole message was
+// cached, and every refresh fetched every part from three endpoints
+// with no units, converting from Kelvin.
+var LEGACY = `
+var WEATHER_CACHE_KEY = "weatherCache";
+
+// Temperature in Kelvin requires adjustment
+function kelvinToCelsius(kelvin) {
+  return Math.round(kelvin - 273.15);
+}
+
+function lookUpWeather(location, watchHasWeather) {
+  var key = weatherCacheKey(location);
+  var cached = readJson(WEATHER_CACHE_KEY);
+  if (cached && cached.key === key) {
+    if (Date.now() - cached.fetched < WEATHER_CACHE_TTL_MINUTES * 60 * 1000) {
+      countCacheLookup("hit");
+      sendWeather(cached.weather);
+      return;
+    }
+
+    // Stale: a watch with nothing to show gets the old weather at once
+    // while the new one is fetched.
+    countCacheLookup("stale");
+    if (!watchHasWeather) {
+      sendWeather(cached.weather);
+    }
+  } else {
+    countCacheLookup("miss");
+  }
+
+  fetchWeather(location, function(weather, complete) {
+    sendWeather(weather);
+    if (complete) {
+      localStorage.setItem(WEATHER_CACHE_KEY,
+                           JSON.stringify({ key: key, fetched: Date.now(), weather: weather }));
+    }
+  });
+}
+function fetchWeather(location, callback) {
+  var current = null;
+  var forecast = null;
+  var hourly = null;
+  var pending = 3;
+
+  var requestDone = function () {
+    pending--;
+    if (pending > 0 || (!current && !forecast && !hourly)) {
+      return;
+    }
+    callback(encodeWeather(current, forecast, hourly),
+             current !== null && forecast !== null && hourly !== null);
+  };
+
+  // Construct URL
+  var url = "http://api.openweathermap.org/data/2.5/weather?lat=" +
+      location.lat + "&lon=" + location.lon;
+
+  // Send request to OpenWeatherMap
+  xhrRequest(url, 'GET', 
+    function(responseText) {
+      // responseText contains a JSON object with weather info
+      var json = parseJson(responseText);
+      if (json && json.main && json.wind && json.weather) {
+        current = {
+          temperature: kelvinToCelsius(json.main.temp),
+          windSpeed: Math.round(json.wind.speed),
+          windDirection: Math.round(json.wind.deg || 0),
+          // The watch turns the condition id into its description.
+          conditionId: json.weather[0].id
+        };
+      }
+      requestDone();
+    }      
+  );
+  
+  // Construct URL
+  var forecasturl = "http://api.openweathermap.org/data/2.5/forecast/daily?lat=" +
+      location.lat + "&lon=" + location.lon;
+
+  // Send request to OpenWeatherMap
+  xhrRequest(forecasturl, 'GET', 
+    function(responseForecastText) {
+      // responseText contains a JSON object with weather info
+      var json = parseJson(responseForecastText);
+      if (json && json.list && json.list.length > 0) {
+        forecast = [];
+        for (var i = 0; i < Math.min(json.list.length, WEATHER_FORECAST_DAYS); i++) {
+          forecast.push({
+            time: json.list[i].dt,
+            conditionId: json.list[i].weather[0].id,
+            min: kelvinToCelsius(json.list[i].temp.min),
+            max: kelvinToCelsius(json.list[i].temp.max)
+          });
+        }
+      }
+      requestDone();
+    }      
+  );
+
+  // Construct URL
+  var hourlyurl = "http://api.openweathermap.org/data/2.5/onecall?lat=" +
+      location.lat + "&lon=" + location.lon + "&exclude=current,minutely,daily,alerts";
+
+  // Send request to OpenWeatherMap
+  xhrRequest(hourlyurl, 'GET',
+    function(responseHourlyText) {
+      var json = parseJson(responseHourlyText);
+      // The watch interpolates between hours, so it needs at least two.
+      if (json && json.hourly && json.hourly.length > 1) {
+        hourly = { time: json.hourly[0].dt, temperatures: [] };
+        for (var i = 0; i < Math.min(json.hourly.length, WEATHER_HOURLY_HOURS); i++) {
+          hourly.temperatures.push(kelvinToCelsius(json.hourly[i].temp));
+        }
+      }
+      requestDone();
+    }
+  );
+  
+}
+`;
+
+function measure(name, phone) {
+  var best = Infinity;
+  runDay(phone); // Makes the documents and warms up.
+  for (var pass = 0; pass < PASSES; pass++) {
+    best = Math.min(best, runDay(phone));
+  }
+  console.log("  " + pad(name, 10) + pad(String(phone.requests), 10) + pad((phone.bytes / REFRESHES).toFixed(0), 14) +
+              pad((best / REFRESHES * 1000).toFixed(1), 14));
+  return phone.sent.map(function(dictionary) { return dictionary.KEY_WEATHER; });
+}
+
+function pad(text, width) {
+  while (text.length < width) {
+    text = " " + text;
+  }
+  return text;
+}
+
+var source = fs.readFileSync(path.join(__dirname, "..", "src", "weatherStream.js"), "utf8");
+
+console.log("weather fetch: " + REFRESHES + " refreshes, one every " + REFRESH_MINUTES +
+            " minutes, best of " + PASSES + " days");
+console.log("  " + pad("", 10) + pad("requests", 10) + pad("bytes/refresh", 14) + pad("us/refresh", 14));
+var legacy = measure("legacy", makePhone(source + "\n" + LEGACY));
+var lean = measure("lean", makePhone(source));
+
+// The current weather goes first in the message, see src/weather.h.
+var CURRENT_BYTES = 9;
+var failures = 0;
+if (legacy.length !== REFRESHES || lean.length !== REFRESHES) {
+  console.log("  sent " + legacy.length + " and " + lean.length + " messages, expected " + REFRESHES);
+  failures++;
+}
+for (var refresh = 0; refresh < Math.min(legacy.length, lean.length); refresh++) {
+  var length = refresh === 0 ? legacy[refresh].length : CURRENT_BYTES;
+  if (JSON.stringify(legacy[refresh].slice(0, length)) !== JSON.stringify(lean[refresh].slice(0, length))) {
+    console.log("  refresh " + refresh + ": the watch is sent different weather");
+    failures++;
+  }
+}
+console.log("  messages that differ: " + failures + " (must be 0)");
+process.exit(failures ? 1 : 0);
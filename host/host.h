@@ -0,0 +1,153 @@
+#pragma once
+
+// Interface between the Pebble API stand-in (pebble_host.c) and the
+// simulator driver (sim.c). Nothing in src/ includes this file.
+
+#include "pebble.h"
+
+#define HOST_MAX_DAYS 31
+
+// Display of the watch the face is laid out for.
+#define HOST_SCREEN_WIDTH 144
+#define HOST_SCREEN_HEIGHT 168
+
+// Everything the power model is built from. One set is kept per
+// simulated day so regressions show up on the day they happen.
+typedef struct {
+  uint32_t wakeups;            // Any event delivered to the app or its worker...
+  uint32_t worker_wakeups;     // ...of which to the worker.
+  uint32_t ticks_second;       // Tick handler calls while on SECOND_UNIT.
+  uint32_t ticks_minute;       // Tick handler calls while on MINUTE_UNIT or coarser.
+  uint32_t taps;
+  uint32_t text_set;           // text_layer_set_text calls.
+  uint32_t tick_text_set;      // ...of which made from the tick handler.
+  uint32_t font_set;           // text_layer_set_font calls.
+  uint32_t frames;             // Frames where at least one layer was dirty.
+  uint32_t dirty_layers;       // Layers marked dirty across all frames.
+  uint32_t layer_visits;       // Layers traversed while rendering frames.
+  uint32_t text_draws;         // Strings rendered by TextLayers or graphics_draw_text.
+  uint32_t damage_pixels;      // Pixels inside the union of dirty layer frames...
+  uint32_t damage_rows;        // ...the display rows they cover, which is what gets pushed...
+  uint32_t changed_pixels;     // ...and the pixels that actually changed.
+  uint32_t tick_frames;        // Frames rendered after a tick...
+  uint32_t tick_damage_pixels; // ...and their damage.
+  uint32_t persist_reads;
+  uint32_t persist_writes;
+  uint32_t persist_write_bytes;
+  uint32_t outbox_sends;
+  uint32_t outbox_bytes;
+  uint32_t outbox_failed;
+  uint32_t inbox_messages;
+  uint32_t inbox_bytes;
+  uint32_t inbox_dropped;
+  uint32_t launches;
+} HostCounters;
+
+// What it took from the start of a launch to its first frame: the
+// app's init and window load. Host time is real CPU time on this
+// machine, so only useful for comparisons between runs.
+typedef struct {
+  uint32_t launches;
+  uint32_t persist_reads;
+  uint32_t text_set;
+  uint32_t localtime_calls;
+  uint64_t host_ns;
+  uint64_t host_ns_max;
+} HostFirstFrame;
+
+extern HostFirstFrame host_first_frame;
+
+// Called just before the app's main(). The first frame rendered after
+// it ends the measurement.
+void host_launch_begin(void);
+
+// The firmware draws the window init pushed soon after init returns,
+// but events already due by then, such as a 0 ms timer, may be handled
+// first. By default the host draws first; this handles them first.
+extern bool host_events_before_first_frame;
+
+HostCounters *host_counters(void);
+#define HOST_COUNT(field, n) (host_counters()->field += (n))
+
+extern HostCounters host_day_counters[HOST_MAX_DAYS];
+
+// Layers and TextLayers currently allocated, and the most seen at once.
+extern int host_layers_live;
+extern int host_layers_peak;
+
+// The app heap. Aplite gives an app 24 KB for its code, statics and
+// heap together; this face's code and statics take about 16 KB of it.
+// Windows, layers and the AppMessage buffers are allocated from the
+// heap, each with the allocator's header, at the host's own (64 bit,
+// so somewhat larger) sizes.
+#define HOST_HEAP_SIZE 8192
+#define HOST_HEAP_HEADER 8
+
+extern uint32_t host_heap_used;
+extern uint32_t host_heap_peak;
+
+// Software framebuffer, one byte per pixel holding GColorBlack or
+// GColorWhite. Every frame is rendered in full, so it always shows what
+// the watch would show after the last event.
+extern uint8_t host_framebuffer[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+
+// Write the framebuffer as a 1 bit grayscale PNG. Returns false if the
+// file could not be written.
+bool host_write_png(const char *path);
+
+// When set, one line per rendered frame: seconds into the run, what
+// caused it, the bounding box of the damage and the counts above.
+extern FILE *host_damage_log;
+
+// Buffer sizes the app passed to app_message_open.
+extern uint32_t host_inbox_size;
+extern uint32_t host_outbox_size;
+
+// Virtual clock, in milliseconds since the epoch.
+extern int64_t host_now_ms;
+extern int64_t host_start_ms;
+extern int64_t host_end_ms;
+
+int host_day_index(void);
+
+// Fail every Nth outbox send that reaches the phone (0 = never).
+extern uint32_t host_outbox_nack_every;
+
+// Settings the simulated watch reports back to the app.
+extern bool host_clock_24h;
+extern bool host_verbose;
+
+// Event queue. Events owned by the app (timers, message delivery) are
+// dropped when the app exits; scenario events keep firing.
+typedef void (*HostEventCallback)(void *data);
+
+void host_schedule(int64_t when_ms, HostEventCallback callback, void *data, bool app_owned);
+
+// Run the virtual clock until the app exits or the timeline ends.
+void host_run_away(int64_t until_ms);
+void host_request_app_exit(void);
+bool host_app_running(void);
+
+// Inputs driven by the scenario.
+void host_set_bluetooth(bool connected);
+void host_set_battery(BatteryChargeState state);
+void host_tap(void);
+
+// Deliver a phone-to-watch message. Returns false if the app is not
+// listening or the message does not fit in the inbox.
+bool host_deliver_inbox(DictionaryIterator *iter);
+
+// Build a dictionary in caller-provided storage (used by the phone model).
+void host_dict_begin(DictionaryIterator *iter, uint8_t *buffer, size_t size);
+
+// Hook for the phone model: called for every message the app sends.
+extern void (*host_phone_on_outbox)(DictionaryIterator *iter);
+extern void (*host_phone_on_launch)(void);
+
+// The background worker's main(), renamed by the Makefile. While it is
+// NULL, app_worker_launch finds no worker.
+extern int (*host_worker_main)(void);
+
+// How long the firmware takes to start the worker after
+// app_worker_launch. Messages the face sends it before then are lost.
+extern int host_worker_start_ms;
@@ -0,0 +1,1911 @@
+// Host implementation of the Pebble API subset declared in pebble.h.
+//
+// Every call that would cost power on the watch (layer updates, flash
+// writes, radio traffic) is counted in the current day's HostCounters.
+// Time only moves when the event loop advances the virtual clock.
+
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include "host.h"
+
+#undef time
+#undef localtime
+
+#define HOST_INBOX_SIZE_MAXIMUM 2026
+#define HOST_OUTBOX_SIZE_MAXIMUM 656
+#define HOST_PERSIST_SLOTS 64
+#define HOST_OUTBOX_ACK_MS 400
+
+HostCounters host_day_counters[HOST_MAX_DAYS];
+HostFirstFrame host_first_frame;
+
+int host_layers_live;
+int host_layers_peak;
+
+uint32_t host_heap_used;
+uint32_t host_heap_peak;
+
+uint32_t host_inbox_size;
+uint32_t host_outbox_size;
+
+int64_t host_now_ms;
+int64_t host_start_ms;
+int64_t host_end_ms;
+
+uint32_t host_outbox_nack_every;
+
+bool host_clock_24h = false;
+bool host_verbose = false;
+bool host_events_before_first_frame = false;
+
+void (*host_phone_on_outbox)(DictionaryIterator *iter);
+void (*host_phone_on_launch)(void);
+
+int host_day_index(void)
+{
+  // Work done while shutting down at the end of the run counts towards
+  // the last simulated day.
+  int64_t now_ms = host_now_ms < host_end_ms ? host_now_ms : host_end_ms - 1;
+  int64_t day = (now_ms - host_start_ms) / 86400000;
+  if (day < 0)
+  {
+    return 0;
+  }
+  if (day >= HOST_MAX_DAYS)
+  {
+    return HOST_MAX_DAYS - 1;
+  }
+  return (int)day;
+}
+
+HostCounters *host_counters(void)
+{
+  return &host_day_counters[host_day_index()];
+}
+
+time_t host_time(time_t *tloc)
+{
+  time_t now = (time_t)(host_now_ms / 1000);
+  if (tloc)
+  {
+    *tloc = now;
+  }
+  return now;
+}
+
+static uint32_t s_localtime_calls;
+
+struct tm *host_localtime(const time_t *timer)
+{
+  s_localtime_calls++;
+  return localtime(timer);
+}
+
+// Where the launch being measured started, or launch_pending is false.
+static struct {
+  bool launch_pending;
+  struct timespec started;
+  uint32_t persist_reads;
+  uint32_t text_set;
+  uint32_t localtime_calls;
+} s_launch;
+
+void host_launch_begin(void)
+{
+  s_launch.launch_pending = true;
+  s_launch.persist_reads = host_counters()->persist_reads;
+  s_launch.text_set = host_counters()->text_set;
+  s_launch.localtime_calls = s_localtime_calls;
+  clock_gettime(CLOCK_MONOTONIC, &s_launch.started);
+}
+
+static void host_launch_end(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t ns = (uint64_t)(now.tv_sec - s_launch.started.tv_sec) * 1000000000u
+              + (now.tv_nsec - s_launch.started.tv_nsec);
+  s_launch.launch_pending = false;
+
+  // The virtual clock doesn't move during a launch, so the day's
+  // counters hold all of it.
+  host_first_frame.launches++;
+  host_first_frame.persist_reads += host_counters()->persist_reads - s_launch.persist_reads;
+  host_first_frame.text_set += host_counters()->text_set - s_launch.text_set;
+  host_first_frame.localtime_calls += s_localtime_calls - s_launch.localtime_calls;
+  host_first_frame.host_ns += ns;
+  if (ns > host_first_frame.host_ns_max)
+  {
+    host_first_frame.host_ns_max = ns;
+  }
+}
+
+void host_app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...)
+{
+  if (!host_verbose)
+  {
+    return;
+  }
+
+  time_t now = host_time(NULL);
+  struct tm *now_tm = localtime(&now);
+  char stamp[20];
+  strftime(stamp, sizeof(stamp), "%m-%d %H:%M:%S", now_tm);
+
+  fprintf(stderr, "[%s] %s:%d ", stamp, src_filename, src_line_number);
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+// App heap. The block's size is kept in front of it, where the watch's
+// allocator keeps its header.
+
+static void *host_heap_alloc(size_t size)
+{
+  size_t *block = malloc(sizeof(size_t) + size);
+  *block = size;
+  host_heap_used += size + HOST_HEAP_HEADER;
+  if (host_heap_used > host_heap_peak)
+  {
+    host_heap_peak = host_heap_used;
+  }
+  return block + 1;
+}
+
+static void host_heap_free(void *pointer)
+{
+  if (!pointer)
+  {
+    return;
+  }
+  size_t *block = (size_t *)pointer - 1;
+  host_heap_used -= *block + HOST_HEAP_HEADER;
+  free(block);
+}
+
+size_t heap_bytes_used(void)
+{
+  return host_heap_used;
+}
+
+size_t heap_bytes_free(void)
+{
+  return (host_heap_used < HOST_HEAP_SIZE) ? HOST_HEAP_SIZE - host_heap_used : 0;
+}
+
+// Fonts. The system fonts are not available on the host, so text is
+// drawn from one 5x7 bitmap font scaled to roughly the size of each
+// system font. Widths are close enough that text wraps and clips where
+// it would on the watch; the pixels are not meant to match.
+
+struct HostFont {
+  const char *key;
+  int height;        // Line height.
+  int glyph_width;   // The 5x7 glyph is scaled to this box...
+  int glyph_height;
+  int advance;       // ...and the pen moves on by this much.
+  bool bold;         // Every column is drawn twice.
+};
+
+static struct HostFont s_fonts[] = {
+  { FONT_KEY_GOTHIC_14, 14, 5, 7, 6, false },
+  { FONT_KEY_GOTHIC_14_BOLD, 14, 5, 7, 6, true },
+  { FONT_KEY_GOTHIC_18, 18, 5, 10, 7, false },
+  { FONT_KEY_GOTHIC_18_BOLD, 18, 5, 10, 7, true },
+  { FONT_KEY_GOTHIC_24, 24, 6, 13, 8, false },
+  { FONT_KEY_GOTHIC_24_BOLD, 24, 6, 13, 8, true },
+  { FONT_KEY_BITHAM_42_BOLD, 42, 15, 30, 19, true },
+};
+
+// Printable ASCII, one byte per column, least significant bit at the top.
+static const uint8_t s_glyphs[95][5] = {
+  { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, // space !
+  { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // " #
+  { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, // $ %
+  { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, // & '
+  { 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, // ( )
+  { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // * +
+  { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, // , -
+  { 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 }, // . /
+  { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // 0 1
+  { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 }, // 2 3
+  { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, // 4 5
+  { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 }, // 6 7
+  { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, // 8 9
+  { 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 }, // : ;
+  { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, // < =
+  { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, // > ?
+  { 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E }, // @ A
+  { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // B C
+  { 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, // D E
+  { 0x7F, 0x09, 0x09, 0x01, 0x01 }, { 0x3E, 0x41, 0x41, 0x51, 0x32 }, // F G
+  { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // H I
+  { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // J K
+  { 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x04, 0x02, 0x7F }, // L M
+  { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // N O
+  { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, // P Q
+  { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 }, // R S
+  { 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // T U
+  { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x7F, 0x20, 0x18, 0x20, 0x7F }, // V W
+  { 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x03, 0x04, 0x78, 0x04, 0x03 }, // X Y
+  { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 }, // Z [
+  { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, // \ ]
+  { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 }, // ^ _
+  { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 }, // ` a
+  { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 }, // b c
+  { 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 }, // d e
+  { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x08, 0x54, 0x54, 0x54, 0x3C }, // f g
+  { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, // h i
+  { 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x7F, 0x10, 0x28, 0x44, 0x00 }, // j k
+  { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 }, // l m
+  { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, // n o
+  { 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C }, // p q
+  { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 }, // r s
+  { 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, // t u
+  { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C }, // v w
+  { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C }, // x y
+  { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, // z {
+  { 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 }, // | }
+  { 0x02, 0x01, 0x02, 0x04, 0x02 },                                   // ~
+};
+
+GFont fonts_get_system_font(const char *font_key)
+{
+  for (size_t i = 0; i < sizeof(s_fonts) / sizeof(s_fonts[0]); i++)
+  {
+    if (strcmp(s_fonts[i].key, font_key) == 0)
+    {
+      return &s_fonts[i];
+    }
+  }
+  fprintf(stderr, "host: unknown font %s\n", font_key);
+  return &s_fonts[0];
+}
+
+// Layers
+
+// Drawing coordinates are relative to the layer; offset turns them into
+// screen coordinates and clip is the part of the screen the layer and
+// all its ancestors cover.
+struct GContext {
+  Layer *layer;
+  GColor fill_color;
+  GColor text_color;
+  GPoint offset;
+  GRect clip;
+};
+
+struct Layer {
+  GRect frame;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  LayerUpdateProc update_proc;
+  bool dirty;
+  bool hidden;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GColor text_color;
+  GColor background_color;
+  GTextAlignment alignment;
+  GTextOverflowMode overflow_mode;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  bool loaded;
+};
+
+static Window *s_top_window;
+
+static void host_layer_init(Layer *layer, GRect frame)
+{
+  memset(layer, 0, sizeof(*layer));
+  layer->frame = frame;
+  layer->dirty = true;
+}
+
+static void host_layer_allocated(void)
+{
+  host_layers_live++;
+  if (host_layers_live > host_layers_peak)
+  {
+    host_layers_peak = host_layers_live;
+  }
+}
+
+Layer *layer_create(GRect frame)
+{
+  Layer *layer = host_heap_alloc(sizeof(Layer));
+  host_layer_init(layer, frame);
+  host_layer_allocated();
+  return layer;
+}
+
+void layer_remove_from_parent(Layer *child)
+{
+  Layer *parent = child->parent;
+  if (!parent)
+  {
+    return;
+  }
+
+  Layer **link = &parent->first_child;
+  while (*link && *link != child)
+  {
+    link = &(*link)->next_sibling;
+  }
+  if (*link)
+  {
+    *link = child->next_sibling;
+  }
+  child->parent = NULL;
+  child->next_sibling = NULL;
+  parent->dirty = true;
+}
+
+void layer_destroy(Layer *layer)
+{
+  if (!layer)
+  {
+    return;
+  }
+  layer_remove_from_parent(layer);
+  host_heap_free(layer);
+  host_layers_live--;
+}
+
+void layer_mark_dirty(Layer *layer)
+{
+  layer->dirty = true;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc)
+{
+  layer->update_proc = update_proc;
+  layer->dirty = true;
+}
+
+void layer_set_frame(Layer *layer, GRect frame)
+{
+  layer->frame = frame;
+  layer->dirty = true;
+  if (layer->parent)
+  {
+    layer->parent->dirty = true;
+  }
+}
+
+bool gcolor_equal(GColor x, GColor y)
+{
+  return x == y;
+}
+
+bool grect_equal(const GRect *const rect_a, const GRect *const rect_b)
+{
+  return (rect_a->origin.x == rect_b->origin.x) && (rect_a->origin.y == rect_b->origin.y) &&
+         (rect_a->size.w == rect_b->size.w) && (rect_a->size.h == rect_b->size.h);
+}
+
+GRect layer_get_frame(const Layer *layer)
+{
+  return layer->frame;
+}
+
+GRect layer_get_bounds(const Layer *layer)
+{
+  return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+void layer_set_hidden(Layer *layer, bool hidden)
+{
+  if (layer->hidden != hidden)
+  {
+    layer->hidden = hidden;
+    layer->dirty = true;
+  }
+}
+
+void layer_add_child(Layer *parent, Layer *child)
+{
+  layer_remove_from_parent(child);
+
+  Layer **link = &parent->first_child;
+  while (*link)
+  {
+    link = &(*link)->next_sibling;
+  }
+  *link = child;
+  child->parent = parent;
+  child->dirty = true;
+}
+
+// Drawing
+
+uint8_t host_framebuffer[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+
+static GRect host_rect_intersect(GRect a, GRect b)
+{
+  int x0 = a.origin.x > b.origin.x ? a.origin.x : b.origin.x;
+  int y0 = a.origin.y > b.origin.y ? a.origin.y : b.origin.y;
+  int x1 = a.origin.x + a.size.w < b.origin.x + b.size.w ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int y1 = a.origin.y + a.size.h < b.origin.y + b.size.h ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+  if (x1 <= x0 || y1 <= y0)
+  {
+    return GRect(0, 0, 0, 0);
+  }
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+// Rectangle in layer coordinates, clipped to what the context may draw.
+static GRect host_context_rect(GContext *ctx, GRect rect)
+{
+  rect.origin.x += ctx->offset.x;
+  rect.origin.y += ctx->offset.y;
+  return host_rect_intersect(rect, ctx->clip);
+}
+
+static void host_fill(GRect rect, GColor color)
+{
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+  {
+    memset(&host_framebuffer[y][rect.origin.x], color, rect.size.w);
+  }
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color)
+{
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color)
+{
+  ctx->text_color = color;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask)
+{
+  // Corners are drawn square; the face only fills plain rectangles.
+  if (ctx->fill_color != GColorClear)
+  {
+    host_fill(host_context_rect(ctx, rect), ctx->fill_color);
+  }
+}
+
+static void host_draw_glyph(GContext *ctx, const struct HostFont *font, char c, int x, int y, GRect clip)
+{
+  if (c < ' ' || c > '~')
+  {
+    c = '?';
+  }
+  const uint8_t *columns = s_glyphs[c - ' '];
+  int width = font->glyph_width + (font->bold ? 1 : 0);
+  for (int gy = 0; gy < font->glyph_height; gy++)
+  {
+    int py = y + gy;
+    if (py < clip.origin.y || py >= clip.origin.y + clip.size.h)
+    {
+      continue;
+    }
+    int row = gy * 7 / font->glyph_height;
+    for (int gx = 0; gx < width; gx++)
+    {
+      int px = x + gx;
+      if (px < clip.origin.x || px >= clip.origin.x + clip.size.w)
+      {
+        continue;
+      }
+      // Bold repeats each column one pixel to the right.
+      bool ink = false;
+      if (gx < font->glyph_width)
+      {
+        ink = columns[gx * 5 / font->glyph_width] & (1 << row);
+      }
+      if (font->bold && gx > 0)
+      {
+        ink |= (columns[(gx - 1) * 5 / font->glyph_width] & (1 << row)) != 0;
+      }
+      if (ink)
+      {
+        host_framebuffer[py][px] = ctx->text_color;
+      }
+    }
+  }
+}
+
+// Length of the next line of text that fits in width pixels, breaking
+// after a space where possible. *next is where the line after it starts.
+static size_t host_text_line(const char *text, const struct HostFont *font, int width, const char **next)
+{
+  size_t fit = 0;
+  while (text[fit] && text[fit] != '\n' && (int)(fit + 1) * font->advance <= width + font->advance - font->glyph_width)
+  {
+    fit++;
+  }
+  if (!text[fit] || text[fit] == '\n')
+  {
+    *next = text[fit] ? &text[fit + 1] : &text[fit];
+    return fit;
+  }
+
+  size_t length = fit;
+  while (length > 0 && text[length] != ' ')
+  {
+    length--;
+  }
+  if (length == 0)
+  {
+    // One word longer than the line: break it anywhere.
+    length = fit > 0 ? fit : 1;
+    *next = &text[length];
+    return length;
+  }
+  *next = &text[length + 1];
+  return length;
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, const GFont font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        const GTextLayoutCacheRef layout)
+{
+  HOST_COUNT(text_draws, 1);
+  if (ctx->text_color == GColorClear)
+  {
+    return;
+  }
+
+  // Word wrap for every overflow mode, clipped to the box. Glyphs sit
+  // in the lower part of the line, below the font's ascent.
+  GRect clip = host_context_rect(ctx, box);
+  int y = ctx->offset.y + box.origin.y + (font->height - font->glyph_height) * 2 / 3;
+  while (*text && y < clip.origin.y + clip.size.h)
+  {
+    const char *next;
+    size_t length = host_text_line(text, font, box.size.w, &next);
+    int width = length > 0 ? (int)length * font->advance - (font->advance - font->glyph_width) : 0;
+    int x = ctx->offset.x + box.origin.x;
+    if (alignment == GTextAlignmentCenter)
+    {
+      x += (box.size.w - width) / 2;
+    }
+    else if (alignment == GTextAlignmentRight)
+    {
+      x += box.size.w - width;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+      host_draw_glyph(ctx, font, text[i], x + (int)i * font->advance, y, clip);
+    }
+    text = next;
+    y += font->height;
+  }
+}
+
+static void host_text_layer_update(Layer *layer, GContext *ctx)
+{
+  TextLayer *text_layer = (TextLayer *)layer;
+  GRect bounds = layer_get_bounds(layer);
+  if (text_layer->background_color != GColorClear)
+  {
+    graphics_context_set_fill_color(ctx, text_layer->background_color);
+    graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  }
+  if (text_layer->text && text_layer->text[0])
+  {
+    graphics_context_set_text_color(ctx, text_layer->text_color);
+    graphics_draw_text(ctx, text_layer->text, text_layer->font, bounds,
+                       text_layer->overflow_mode, text_layer->alignment, NULL);
+  }
+}
+
+TextLayer *text_layer_create(GRect frame)
+{
+  TextLayer *text_layer = host_heap_alloc(sizeof(TextLayer));
+  memset(text_layer, 0, sizeof(*text_layer));
+  host_layer_init(&text_layer->layer, frame);
+  host_layer_allocated();
+  text_layer->layer.update_proc = host_text_layer_update;
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+  text_layer->alignment = GTextAlignmentLeft;
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer)
+{
+  layer_destroy(&text_layer->layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer)
+{
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text)
+{
+  HOST_COUNT(text_set, 1);
+  text_layer->text = text;
+  text_layer->layer.dirty = true;
+}
+
+const char *text_layer_get_text(TextLayer *text_layer)
+{
+  return text_layer->text;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color)
+{
+  text_layer->background_color = color;
+  text_layer->layer.dirty = true;
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color)
+{
+  text_layer->text_color = color;
+  text_layer->layer.dirty = true;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font)
+{
+  HOST_COUNT(font_set, 1);
+  text_layer->font = font;
+  text_layer->layer.dirty = true;
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment)
+{
+  text_layer->alignment = text_alignment;
+  text_layer->layer.dirty = true;
+}
+
+void text_layer_set_overflow_mode(TextLayer *text_layer, GTextOverflowMode line_mode)
+{
+  text_layer->overflow_mode = line_mode;
+  text_layer->layer.dirty = true;
+}
+
+// Walk the layer tree the way the firmware does at the end of an event:
+// if anything is dirty, the whole window is redrawn once. What the
+// display has to be sent is only the damage, the union of the frames of
+// the layers that were dirty.
+static uint8_t s_damage[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+static uint8_t s_shown[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+static bool s_tick_pending; // The next frame is the tick's.
+
+FILE *host_damage_log;
+
+static int host_collect_damage(Layer *layer, GPoint offset, GRect clip)
+{
+  GRect frame = layer->frame;
+  frame.origin.x += offset.x;
+  frame.origin.y += offset.y;
+  clip = host_rect_intersect(frame, clip);
+
+  int dirty = 0;
+  if (layer->dirty)
+  {
+    dirty = 1;
+    for (int y = clip.origin.y; y < clip.origin.y + clip.size.h; y++)
+    {
+      memset(&s_damage[y][clip.origin.x], 1, clip.size.w);
+    }
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling)
+  {
+    dirty += host_collect_damage(child, frame.origin, clip);
+  }
+  return dirty;
+}
+
+static void host_draw_layer(Layer *layer, GPoint offset, GRect clip)
+{
+  GRect frame = layer->frame;
+  frame.origin.x += offset.x;
+  frame.origin.y += offset.y;
+  clip = host_rect_intersect(frame, clip);
+
+  layer->dirty = false;
+  HOST_COUNT(layer_visits, 1);
+  if (layer->update_proc && !layer->hidden)
+  {
+    GContext ctx = { layer, GColorBlack, GColorBlack, frame.origin, clip };
+    layer->update_proc(layer, &ctx);
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling)
+  {
+    host_draw_layer(child, frame.origin, clip);
+  }
+}
+
+static void host_render_frame(void)
+{
+  bool tick = s_tick_pending;
+  s_tick_pending = false;
+  if (!s_top_window || !s_top_window->loaded)
+  {
+    return;
+  }
+
+  GRect screen = GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT);
+  memset(s_damage, 0, sizeof(s_damage));
+  int dirty = host_collect_damage(&s_top_window->root, GPoint(0, 0), screen);
+  if (dirty == 0)
+  {
+    return;
+  }
+
+  // The window background, then every layer on top of it.
+  host_fill(screen, GColorWhite);
+  host_draw_layer(&s_top_window->root, GPoint(0, 0), screen);
+
+  uint32_t damage = 0, rows = 0, changed = 0;
+  int x0 = HOST_SCREEN_WIDTH, y0 = HOST_SCREEN_HEIGHT, x1 = -1, y1 = -1;
+  for (int y = 0; y < HOST_SCREEN_HEIGHT; y++)
+  {
+    uint32_t row_damage = 0;
+    for (int x = 0; x < HOST_SCREEN_WIDTH; x++)
+    {
+      if (s_damage[y][x])
+      {
+        row_damage++;
+        x0 = x < x0 ? x : x0;
+        x1 = x > x1 ? x : x1;
+      }
+      changed += host_framebuffer[y][x] != s_shown[y][x];
+    }
+    if (row_damage)
+    {
+      damage += row_damage;
+      rows++;
+      y0 = y < y0 ? y : y0;
+      y1 = y;
+    }
+  }
+  memcpy(s_shown, host_framebuffer, sizeof(s_shown));
+
+  HOST_COUNT(frames, 1);
+  HOST_COUNT(dirty_layers, dirty);
+  HOST_COUNT(damage_pixels, damage);
+  HOST_COUNT(damage_rows, rows);
+  HOST_COUNT(changed_pixels, changed);
+  if (tick)
+  {
+    HOST_COUNT(tick_frames, 1);
+    HOST_COUNT(tick_damage_pixels, damage);
+  }
+
+  if (s_launch.launch_pending)
+  {
+    host_launch_end();
+  }
+
+  if (host_damage_log)
+  {
+    if (rows == 0)
+    {
+      x0 = y0 = 0;
+      x1 = y1 = -1;
+    }
+    fprintf(host_damage_log, "%.3f %s %d %d %d %d %u %u %u\n",
+            (host_now_ms - host_start_ms) / 1000.0, tick ? "tick" : "event",
+            x0, y0, x1 - x0 + 1, y1 - y0 + 1, damage, rows, changed);
+  }
+}
+
+// PNG, written with stored (uncompressed) deflate blocks so no zlib is
+// needed. The same framebuffer always gives the same bytes.
+
+static uint32_t host_crc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static void host_put_be32(uint8_t *data, uint32_t value)
+{
+  data[0] = value >> 24;
+  data[1] = value >> 16;
+  data[2] = value >> 8;
+  data[3] = value;
+}
+
+static void host_png_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t length)
+{
+  uint8_t header[8];
+  host_put_be32(header, length);
+  memcpy(&header[4], type, 4);
+  uint32_t crc = host_crc32(host_crc32(0, &header[4], 4), data, length);
+  uint8_t trailer[4];
+  host_put_be32(trailer, crc);
+  fwrite(header, 1, sizeof(header), file);
+  fwrite(data, 1, length, file);
+  fwrite(trailer, 1, sizeof(trailer), file);
+}
+
+bool host_write_png(const char *path)
+{
+  // Anything still dirty is drawn first, as the firmware would before
+  // the display is next looked at.
+  host_render_frame();
+
+  // One filter byte and 18 bytes of pixels per row, 0 = black.
+  enum { ROW_BYTES = 1 + HOST_SCREEN_WIDTH / 8, RAW_BYTES = ROW_BYTES * HOST_SCREEN_HEIGHT };
+  static uint8_t zlib[2 + 5 + RAW_BYTES + 4];
+  uint8_t *raw = &zlib[7];
+  memset(raw, 0, RAW_BYTES);
+  for (int y = 0; y < HOST_SCREEN_HEIGHT; y++)
+  {
+    for (int x = 0; x < HOST_SCREEN_WIDTH; x++)
+    {
+      if (host_framebuffer[y][x] == GColorWhite)
+      {
+        raw[y * ROW_BYTES + 1 + x / 8] |= 0x80 >> (x % 8);
+      }
+    }
+  }
+
+  uint32_t a = 1, b = 0;
+  for (int i = 0; i < RAW_BYTES; i++)
+  {
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  zlib[0] = 0x78;
+  zlib[1] = 0x01;
+  zlib[2] = 0x01; // Final block, stored.
+  zlib[3] = RAW_BYTES & 0xFF;
+  zlib[4] = RAW_BYTES >> 8;
+  zlib[5] = ~RAW_BYTES & 0xFF;
+  zlib[6] = (~RAW_BYTES >> 8) & 0xFF;
+  host_put_be32(&zlib[7 + RAW_BYTES], (b << 16) | a);
+
+  uint8_t ihdr[13];
+  host_put_be32(&ihdr[0], HOST_SCREEN_WIDTH);
+  host_put_be32(&ihdr[4], HOST_SCREEN_HEIGHT);
+  ihdr[8] = 1;  // Bit depth.
+  ihdr[9] = 0;  // Grayscale.
+  ihdr[10] = 0; // Compression, filter and interlace methods.
+  ihdr[11] = 0;
+  ihdr[12] = 0;
+
+  FILE *file = fopen(path, "wb");
+  if (!file)
+  {
+    return false;
+  }
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  fwrite(signature, 1, sizeof(signature), file);
+  host_png_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+  host_png_chunk(file, "IDAT", zlib, sizeof(zlib));
+  host_png_chunk(file, "IEND", NULL, 0);
+  return fclose(file) == 0;
+}
+
+// Windows
+
+Window *window_create(void)
+{
+  Window *window = host_heap_alloc(sizeof(Window));
+  memset(window, 0, sizeof(*window));
+  host_layer_init(&window->root, GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT));
+  return window;
+}
+
+void window_destroy(Window *window)
+{
+  if (window->loaded && window->handlers.unload)
+  {
+    window->handlers.unload(window);
+  }
+  window->loaded = false;
+  if (s_top_window == window)
+  {
+    s_top_window = NULL;
+  }
+  host_heap_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers)
+{
+  window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window)
+{
+  return (Layer *)&window->root;
+}
+
+void window_stack_push(Window *window, bool animated)
+{
+  s_top_window = window;
+  if (!window->loaded)
+  {
+    window->loaded = true;
+    if (window->handlers.load)
+    {
+      window->handlers.load(window);
+    }
+  }
+  if (window->handlers.appear)
+  {
+    window->handlers.appear(window);
+  }
+  window->root.dirty = true;
+}
+
+// Event queue
+
+typedef struct HostEvent {
+  int64_t when_ms;
+  HostEventCallback callback;
+  void *data;
+  bool app_owned;
+  struct HostEvent *next;
+} HostEvent;
+
+static HostEvent *s_events;
+static bool s_app_running;
+static bool s_exit_requested;
+
+static void host_link_event(HostEvent *event)
+{
+  HostEvent **link = &s_events;
+  while (*link && (*link)->when_ms <= event->when_ms)
+  {
+    link = &(*link)->next;
+  }
+  event->next = *link;
+  *link = event;
+}
+
+static HostEvent *host_insert_event(int64_t when_ms, HostEventCallback callback, void *data, bool app_owned)
+{
+  HostEvent *event = malloc(sizeof(HostEvent));
+  event->when_ms = when_ms;
+  event->callback = callback;
+  event->data = data;
+  event->app_owned = app_owned;
+  host_link_event(event);
+  return event;
+}
+
+static bool host_unlink_event(HostEvent *event)
+{
+  for (HostEvent **link = &s_events; *link; link = &(*link)->next)
+  {
+    if (*link == event)
+    {
+      *link = event->next;
+      return true;
+    }
+  }
+  return false;
+}
+
+void host_schedule(int64_t when_ms, HostEventCallback callback, void *data, bool app_owned)
+{
+  host_insert_event(when_ms, callback, data, app_owned);
+}
+
+// Timers
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data)
+{
+  return (AppTimer *)host_insert_event(host_now_ms + timeout_ms, callback, callback_data, true);
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms)
+{
+  HostEvent *event = (HostEvent *)timer_handle;
+  if (!host_unlink_event(event))
+  {
+    return false;
+  }
+  event->when_ms = host_now_ms + new_timeout_ms;
+  host_link_event(event);
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle)
+{
+  HostEvent *event = (HostEvent *)timer_handle;
+  if (host_unlink_event(event))
+  {
+    free(event);
+  }
+}
+
+// Tick timer service. The face and the background worker subscribe
+// separately.
+
+typedef struct {
+  TickHandler handler;
+  TimeUnits units;
+  time_t last;
+  struct tm last_tm;
+} HostTickService;
+
+static HostTickService s_app_ticks;
+static HostTickService s_worker_ticks;
+
+// Set while the worker's code runs, so that what it subscribes to is
+// kept apart from the face's.
+static bool s_in_worker;
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler)
+{
+  HostTickService *service = s_in_worker ? &s_worker_ticks : &s_app_ticks;
+  service->handler = handler;
+  service->units = tick_units;
+  service->last = host_time(NULL);
+  service->last_tm = *localtime(&service->last);
+}
+
+void tick_timer_service_unsubscribe(void)
+{
+  (s_in_worker ? &s_worker_ticks : &s_app_ticks)->handler = NULL;
+}
+
+static int64_t host_next_tick_ms(const HostTickService *service)
+{
+  if (!service->handler)
+  {
+    return INT64_MAX;
+  }
+  if (service->units & SECOND_UNIT)
+  {
+    return ((int64_t)service->last + 1) * 1000;
+  }
+  if (service->units & MINUTE_UNIT)
+  {
+    return ((int64_t)service->last / 60 + 1) * 60 * 1000;
+  }
+  // Hours and coarser. Time zones are whole hours off UTC here.
+  return ((int64_t)service->last / 3600 + 1) * 3600 * 1000;
+}
+
+static TimeUnits host_tick_changes(HostTickService *service, struct tm *now_tm)
+{
+  time_t now = host_time(NULL);
+  *now_tm = *localtime(&now);
+
+  TimeUnits changed = 0;
+  if (now_tm->tm_sec != service->last_tm.tm_sec)
+  {
+    changed |= SECOND_UNIT;
+  }
+  if (now_tm->tm_min != service->last_tm.tm_min)
+  {
+    changed |= MINUTE_UNIT;
+  }
+  if (now_tm->tm_hour != service->last_tm.tm_hour)
+  {
+    changed |= HOUR_UNIT;
+  }
+  if (now_tm->tm_mday != service->last_tm.tm_mday)
+  {
+    changed |= DAY_UNIT;
+  }
+  if (now_tm->tm_mon != service->last_tm.tm_mon)
+  {
+    changed |= MONTH_UNIT;
+  }
+  if (now_tm->tm_year != service->last_tm.tm_year)
+  {
+    changed |= YEAR_UNIT;
+  }
+
+  service->last = now;
+  service->last_tm = *now_tm;
+  return changed;
+}
+
+static void host_deliver_tick(void)
+{
+  struct tm now_tm;
+  TimeUnits changed = host_tick_changes(&s_app_ticks, &now_tm);
+  if (changed & s_app_ticks.units)
+  {
+    HOST_COUNT(wakeups, 1);
+    if (s_app_ticks.units & SECOND_UNIT)
+    {
+      HOST_COUNT(ticks_second, 1);
+    }
+    else
+    {
+      HOST_COUNT(ticks_minute, 1);
+    }
+    uint32_t text_set = host_counters()->text_set;
+    s_tick_pending = true;
+    s_app_ticks.handler(&now_tm, changed);
+    HOST_COUNT(tick_text_set, host_counters()->text_set - text_set);
+  }
+}
+
+static void host_deliver_worker_tick(void)
+{
+  struct tm now_tm;
+  TimeUnits changed = host_tick_changes(&s_worker_ticks, &now_tm);
+  if (changed & s_worker_ticks.units)
+  {
+    HOST_COUNT(wakeups, 1);
+    HOST_COUNT(worker_wakeups, 1);
+    s_in_worker = true;
+    s_worker_ticks.handler(&now_tm, changed);
+    s_in_worker = false;
+  }
+}
+
+// Accelerometer, battery and bluetooth services
+
+static AccelTapHandler s_tap_handler;
+static BatteryStateHandler s_battery_handler;
+static BatteryChargeState s_battery_state = { 100, false, false };
+static BluetoothConnectionHandler s_bluetooth_handler;
+static bool s_bluetooth_connected = true;
+
+void accel_tap_service_subscribe(AccelTapHandler handler)
+{
+  s_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void)
+{
+  s_tap_handler = NULL;
+}
+
+void host_tap(void)
+{
+  if (s_tap_handler)
+  {
+    HOST_COUNT(wakeups, 1);
+    HOST_COUNT(taps, 1);
+    s_tap_handler(ACCEL_AXIS_Y, 1);
+  }
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler)
+{
+  s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void)
+{
+  s_battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void)
+{
+  return s_battery_state;
+}
+
+void host_set_battery(BatteryChargeState state)
+{
+  s_battery_state = state;
+  if (s_battery_handler)
+  {
+    HOST_COUNT(wakeups, 1);
+    s_battery_handler(state);
+  }
+}
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler)
+{
+  s_bluetooth_handler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe(void)
+{
+  s_bluetooth_handler = NULL;
+}
+
+bool bluetooth_connection_service_peek(void)
+{
+  return s_bluetooth_connected;
+}
+
+void host_set_bluetooth(bool connected)
+{
+  if (s_bluetooth_connected == connected)
+  {
+    return;
+  }
+  s_bluetooth_connected = connected;
+  if (s_bluetooth_handler)
+  {
+    HOST_COUNT(wakeups, 1);
+    s_bluetooth_handler(connected);
+  }
+}
+
+bool clock_is_24h_style(void)
+{
+  return host_clock_24h;
+}
+
+// Dictionaries. The layout matches the firmware: one count byte followed
+// by packed tuples with a 7 byte header each.
+
+void host_dict_begin(DictionaryIterator *iter, uint8_t *buffer, size_t size)
+{
+  iter->dictionary = buffer;
+  iter->end = buffer + size;
+  buffer[0] = 0;
+  iter->cursor = (Tuple *)(buffer + 1);
+}
+
+static size_t host_dict_size(const DictionaryIterator *iter)
+{
+  return (size_t)((uint8_t *)iter->cursor - iter->dictionary);
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter)
+{
+  iter->cursor = (Tuple *)(iter->dictionary + 1);
+  return iter->dictionary[0] ? iter->cursor : NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter)
+{
+  uint8_t *next = (uint8_t *)iter->cursor + sizeof(Tuple) + iter->cursor->length;
+  if (next >= iter->end)
+  {
+    return NULL;
+  }
+  iter->cursor = (Tuple *)next;
+  return iter->cursor;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key)
+{
+  DictionaryIterator copy = *iter;
+  for (Tuple *t = dict_read_first(&copy); t; t = dict_read_next(&copy))
+  {
+    if (t->key == key)
+    {
+      return t;
+    }
+  }
+  return NULL;
+}
+
+static DictionaryResult host_dict_append(DictionaryIterator *iter, uint32_t key, TupleType type, const void *data, uint16_t length)
+{
+  if (!iter || !iter->dictionary)
+  {
+    return DICT_INVALID_ARGS;
+  }
+  uint8_t *start = (uint8_t *)iter->cursor;
+  if (start + sizeof(Tuple) + length > iter->end)
+  {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  Tuple *t = iter->cursor;
+  t->key = key;
+  t->type = type;
+  t->length = length;
+  memcpy(t->value, data, length);
+  iter->cursor = (Tuple *)(start + sizeof(Tuple) + length);
+  iter->dictionary[0]++;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size)
+{
+  return host_dict_append(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char * const cstring)
+{
+  return host_dict_append(iter, key, TUPLE_CSTRING, cstring, (uint16_t)(strlen(cstring) + 1));
+}
+
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key, const void *integer, const uint8_t width_bytes, const bool is_signed)
+{
+  return host_dict_append(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value)
+{
+  return dict_write_int(iter, key, &value, sizeof(value), false);
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value)
+{
+  return dict_write_int(iter, key, &value, sizeof(value), false);
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value)
+{
+  return dict_write_int(iter, key, &value, sizeof(value), false);
+}
+
+DictionaryResult dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value)
+{
+  return dict_write_int(iter, key, &value, sizeof(value), true);
+}
+
+DictionaryResult dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value)
+{
+  return dict_write_int(iter, key, &value, sizeof(value), true);
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value)
+{
+  return dict_write_int(iter, key, &value, sizeof(value), true);
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter)
+{
+  if (!iter || !iter->dictionary)
+  {
+    return 0;
+  }
+  return (uint32_t)host_dict_size(iter);
+}
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...)
+{
+  uint32_t size = 1 + tuple_count * sizeof(Tuple);
+  va_list args;
+  va_start(args, tuple_count);
+  for (int i = 0; i < tuple_count; i++)
+  {
+    size += va_arg(args, uint32_t);
+  }
+  va_end(args);
+  return size;
+}
+
+// AppMessage
+
+static AppMessageInboxReceived s_inbox_received;
+static AppMessageInboxDropped s_inbox_dropped;
+static AppMessageOutboxSent s_outbox_sent;
+static AppMessageOutboxFailed s_outbox_failed;
+static bool s_app_message_open;
+static uint8_t s_outbox_buffer[HOST_OUTBOX_SIZE_MAXIMUM];
+static DictionaryIterator s_outbox_iter;
+static bool s_outbox_begun;
+static bool s_outbox_in_flight;
+static uint32_t s_sends_since_nack;
+
+uint32_t app_message_inbox_size_maximum(void)
+{
+  return HOST_INBOX_SIZE_MAXIMUM;
+}
+
+uint32_t app_message_outbox_size_maximum(void)
+{
+  return HOST_OUTBOX_SIZE_MAXIMUM;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound)
+{
+  if (size_inbound > HOST_INBOX_SIZE_MAXIMUM || size_outbound > HOST_OUTBOX_SIZE_MAXIMUM)
+  {
+    return APP_MSG_OUT_OF_MEMORY;
+  }
+  host_inbox_size = size_inbound;
+  host_outbox_size = size_outbound;
+  if (!s_app_message_open)
+  {
+    // The watch allocates both buffers from the app heap.
+    host_heap_used += size_inbound + size_outbound + 2 * HOST_HEAP_HEADER;
+    if (host_heap_used > host_heap_peak)
+    {
+      host_heap_peak = host_heap_used;
+    }
+  }
+  s_app_message_open = true;
+
+  // PebbleKit JS sends its 'ready' event once the app is listening.
+  if (host_phone_on_launch)
+  {
+    host_phone_on_launch();
+  }
+  return APP_MSG_OK;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback)
+{
+  AppMessageInboxReceived previous = s_inbox_received;
+  s_inbox_received = received_callback;
+  return previous;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback)
+{
+  AppMessageInboxDropped previous = s_inbox_dropped;
+  s_inbox_dropped = dropped_callback;
+  return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback)
+{
+  AppMessageOutboxSent previous = s_outbox_sent;
+  s_outbox_sent = sent_callback;
+  return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback)
+{
+  AppMessageOutboxFailed previous = s_outbox_failed;
+  s_outbox_failed = failed_callback;
+  return previous;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator)
+{
+  if (!s_app_message_open)
+  {
+    *iterator = NULL;
+    return APP_MSG_CLOSED;
+  }
+  if (s_outbox_in_flight)
+  {
+    *iterator = NULL;
+    return APP_MSG_BUSY;
+  }
+  host_dict_begin(&s_outbox_iter, s_outbox_buffer, host_outbox_size);
+  s_outbox_begun = true;
+  *iterator = &s_outbox_iter;
+  return APP_MSG_OK;
+}
+
+static void host_outbox_sent(void *data)
+{
+  s_outbox_in_flight = false;
+  if (s_outbox_sent)
+  {
+    HOST_COUNT(wakeups, 1);
+    s_outbox_sent(&s_outbox_iter, NULL);
+  }
+}
+
+static void host_outbox_failed(void *data)
+{
+  s_outbox_in_flight = false;
+  HOST_COUNT(outbox_failed, 1);
+  if (s_outbox_failed)
+  {
+    HOST_COUNT(wakeups, 1);
+    s_outbox_failed(&s_outbox_iter, (AppMessageResult)(intptr_t)data, NULL);
+  }
+}
+
+AppMessageResult app_message_outbox_send(void)
+{
+  if (!s_outbox_begun)
+  {
+    return s_outbox_in_flight ? APP_MSG_BUSY : APP_MSG_INVALID_ARGS;
+  }
+  s_outbox_begun = false;
+  s_outbox_in_flight = true;
+
+  HOST_COUNT(outbox_sends, 1);
+  HOST_COUNT(outbox_bytes, host_dict_size(&s_outbox_iter));
+
+  if (!s_bluetooth_connected)
+  {
+    host_insert_event(host_now_ms + HOST_OUTBOX_ACK_MS, host_outbox_failed,
+                      (void *)(intptr_t)APP_MSG_NOT_CONNECTED, true);
+    return APP_MSG_OK;
+  }
+
+  // The phone never saw this one: it times out instead of being acked.
+  if (host_outbox_nack_every && (++s_sends_since_nack >= host_outbox_nack_every))
+  {
+    s_sends_since_nack = 0;
+    host_insert_event(host_now_ms + HOST_OUTBOX_ACK_MS, host_outbox_failed,
+                      (void *)(intptr_t)APP_MSG_SEND_TIMEOUT, true);
+    return APP_MSG_OK;
+  }
+
+  host_insert_event(host_now_ms + HOST_OUTBOX_ACK_MS, host_outbox_sent, NULL, true);
+  if (host_phone_on_outbox)
+  {
+    DictionaryIterator copy = s_outbox_iter;
+    copy.end = (uint8_t *)s_outbox_iter.cursor;
+    host_phone_on_outbox(&copy);
+  }
+  return APP_MSG_OK;
+}
+
+bool host_deliver_inbox(DictionaryIterator *iter)
+{
+  if (!s_app_running || !s_app_message_open || !s_bluetooth_connected)
+  {
+    return false;
+  }
+
+  size_t size = host_dict_size(iter);
+  if (size > host_inbox_size)
+  {
+    HOST_COUNT(inbox_dropped, 1);
+    if (s_inbox_dropped)
+    {
+      HOST_COUNT(wakeups, 1);
+      s_inbox_dropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+    }
+    return false;
+  }
+
+  HOST_COUNT(wakeups, 1);
+  HOST_COUNT(inbox_messages, 1);
+  HOST_COUNT(inbox_bytes, size);
+  if (s_inbox_received)
+  {
+    DictionaryIterator copy = *iter;
+    copy.end = (uint8_t *)iter->cursor;
+    s_inbox_received(&copy, NULL);
+  }
+  return true;
+}
+
+// Persistent storage. Contents survive app exits for the whole run.
+
+typedef struct {
+  bool used;
+  uint32_t key;
+  uint16_t length;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} HostPersistSlot;
+
+static HostPersistSlot s_persist[HOST_PERSIST_SLOTS];
+
+static HostPersistSlot *host_persist_find(uint32_t key, bool create)
+{
+  HostPersistSlot *free_slot = NULL;
+  for (int i = 0; i < HOST_PERSIST_SLOTS; i++)
+  {
+    if (s_persist[i].used && s_persist[i].key == key)
+    {
+      return &s_persist[i];
+    }
+    if (!s_persist[i].used && !free_slot)
+    {
+      free_slot = &s_persist[i];
+    }
+  }
+  if (create && free_slot)
+  {
+    free_slot->used = true;
+    free_slot->key = key;
+    free_slot->length = 0;
+    return free_slot;
+  }
+  return NULL;
+}
+
+bool persist_exists(const uint32_t key)
+{
+  HOST_COUNT(persist_reads, 1);
+  return host_persist_find(key, false) != NULL;
+}
+
+int persist_get_size(const uint32_t key)
+{
+  HostPersistSlot *slot = host_persist_find(key, false);
+  return slot ? slot->length : E_DOES_NOT_EXIST;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size)
+{
+  HOST_COUNT(persist_reads, 1);
+  HostPersistSlot *slot = host_persist_find(key, false);
+  if (!slot)
+  {
+    return E_DOES_NOT_EXIST;
+  }
+  size_t length = slot->length < buffer_size ? slot->length : buffer_size;
+  memcpy(buffer, slot->data, length);
+  return (int)length;
+}
+
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size)
+{
+  int length = persist_read_data(key, buffer, buffer_size);
+  if (length > 0)
+  {
+    buffer[buffer_size - 1] = 0;
+  }
+  return length;
+}
+
+int32_t persist_read_int(const uint32_t key)
+{
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+bool persist_read_bool(const uint32_t key)
+{
+  bool value = false;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+status_t persist_write_data(const uint32_t key, const void *data, const size_t size)
+{
+  HostPersistSlot *slot = host_persist_find(key, true);
+  if (!slot)
+  {
+    return E_ERROR;
+  }
+  size_t length = size < PERSIST_DATA_MAX_LENGTH ? size : PERSIST_DATA_MAX_LENGTH;
+  memcpy(slot->data, data, length);
+  slot->length = (uint16_t)length;
+
+  HOST_COUNT(persist_writes, 1);
+  HOST_COUNT(persist_write_bytes, length);
+  return (status_t)length;
+}
+
+status_t persist_write_string(const uint32_t key, const char *cstring)
+{
+  return persist_write_data(key, cstring, strlen(cstring) + 1);
+}
+
+status_t persist_write_int(const uint32_t key, const int32_t value)
+{
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+status_t persist_write_bool(const uint32_t key, const bool value)
+{
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+status_t persist_delete(const uint32_t key)
+{
+  HostPersistSlot *slot = host_persist_find(key, false);
+  if (!slot)
+  {
+    return E_DOES_NOT_EXIST;
+  }
+  slot->used = false;
+  return S_SUCCESS;
+}
+
+// Background worker. It runs from its first launch to the end of the
+// timeline, through every launch of the face. Its main() is entered
+// once; worker_event_loop jumps straight back out, leaving the worker's
+// handlers to be called from the same event loop as the face's.
+
+int (*host_worker_main)(void);
+int host_worker_start_ms;
+
+static bool s_worker_running;
+static jmp_buf s_worker_started;
+static AppWorkerMessageHandler s_worker_message_handler;   // The face's...
+static AppWorkerMessageHandler s_worker_side_handler;      // ...and the worker's.
+
+typedef struct {
+  uint16_t type;
+  AppWorkerMessage data;
+} HostWorkerMessage;
+
+static void host_worker_start(void *data)
+{
+  s_in_worker = true;
+  if (setjmp(s_worker_started) == 0)
+  {
+    host_worker_main();
+  }
+  s_in_worker = false;
+}
+
+void worker_event_loop(void)
+{
+  longjmp(s_worker_started, 1);
+}
+
+bool app_worker_is_running(void)
+{
+  return s_worker_running;
+}
+
+AppWorkerResult app_worker_launch(void)
+{
+  if (!host_worker_main)
+  {
+    return APP_WORKER_RESULT_NO_WORKER;
+  }
+  if (s_worker_running)
+  {
+    return APP_WORKER_RESULT_ALREADY_RUNNING;
+  }
+  s_worker_running = true;
+  host_schedule(host_now_ms + host_worker_start_ms, host_worker_start, NULL, false);
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler)
+{
+  *(s_in_worker ? &s_worker_side_handler : &s_worker_message_handler) = handler;
+  return true;
+}
+
+bool app_worker_message_unsubscribe(void)
+{
+  *(s_in_worker ? &s_worker_side_handler : &s_worker_message_handler) = NULL;
+  return true;
+}
+
+static void host_worker_message_to_app(void *data)
+{
+  HostWorkerMessage *message = data;
+  if (s_worker_message_handler)
+  {
+    HOST_COUNT(wakeups, 1);
+    s_worker_message_handler(message->type, &message->data);
+  }
+  free(message);
+}
+
+static void host_worker_message_to_worker(void *data)
+{
+  HostWorkerMessage *message = data;
+  if (s_worker_side_handler)
+  {
+    HOST_COUNT(wakeups, 1);
+    HOST_COUNT(worker_wakeups, 1);
+    s_in_worker = true;
+    s_worker_side_handler(message->type, &message->data);
+    s_in_worker = false;
+  }
+  free(message);
+}
+
+// Delivered on the next pass of the event loop. A message for a face
+// that has exited by then is dropped.
+void app_worker_send_message(uint8_t type, AppWorkerMessage *data)
+{
+  HostWorkerMessage *message = malloc(sizeof(HostWorkerMessage));
+  message->type = type;
+  message->data = *data;
+  if (s_in_worker)
+  {
+    host_schedule(host_now_ms, host_worker_message_to_app, message, false);
+  }
+  else
+  {
+    host_schedule(host_now_ms, host_worker_message_to_worker, message, false);
+  }
+}
+
+// Event loop
+
+static void host_run(int64_t until_ms)
+{
+  while (!s_exit_requested)
+  {
+    int64_t tick_ms = host_next_tick_ms(&s_app_ticks);
+    int64_t worker_tick_ms = host_next_tick_ms(&s_worker_ticks);
+    int64_t event_ms = s_events ? s_events->when_ms : INT64_MAX;
+    int64_t next_ms = tick_ms < event_ms ? tick_ms : event_ms;
+    next_ms = worker_tick_ms < next_ms ? worker_tick_ms : next_ms;
+    if (next_ms >= until_ms)
+    {
+      host_now_ms = until_ms;
+      return;
+    }
+
+    host_now_ms = next_ms;
+    if (worker_tick_ms == next_ms)
+    {
+      // Ticks due together are delivered one per pass, the worker's first.
+      host_deliver_worker_tick();
+    }
+    else if (tick_ms <= event_ms)
+    {
+      host_deliver_tick();
+    }
+    else
+    {
+      HostEvent *event = s_events;
+      s_events = event->next;
+      HostEventCallback callback = event->callback;
+      void *data = event->data;
+      free(event);
+      callback(data);
+    }
+
+    if (s_app_running)
+    {
+      host_render_frame();
+    }
+  }
+}
+
+void app_event_loop(void)
+{
+  HOST_COUNT(launches, 1);
+  s_app_running = true;
+  s_exit_requested = false;
+  if (host_events_before_first_frame)
+  {
+    // Only the events, not the ticks: the clock hasn't moved.
+    while (s_events && (s_events->when_ms <= host_now_ms) && !s_exit_requested)
+    {
+      HostEvent *event = s_events;
+      s_events = event->next;
+      HostEventCallback callback = event->callback;
+      void *data = event->data;
+      free(event);
+      callback(data);
+    }
+  }
+  host_render_frame();
+  host_run(host_end_ms);
+  s_app_running = false;
+}
+
+bool host_app_running(void)
+{
+  return s_app_running;
+}
+
+void host_request_app_exit(void)
+{
+  s_exit_requested = true;
+}
+
+void host_run_away(int64_t until_ms)
+{
+  // The app has exited: drop everything that belonged to it, just as the
+  // firmware does, and let the rest of the world carry on.
+  for (HostEvent **link = &s_events; *link;)
+  {
+    HostEvent *event = *link;
+    if (event->app_owned)
+    {
+      *link = event->next;
+      free(event);
+    }
+    else
+    {
+      link = &event->next;
+    }
+  }
+  s_app_ticks.handler = NULL;
+  s_worker_message_handler = NULL;
+  s_tap_handler = NULL;
+  s_battery_handler = NULL;
+  s_bluetooth_handler = NULL;
+  s_inbox_received = NULL;
+  s_inbox_dropped = NULL;
+  s_outbox_sent = NULL;
+  s_outbox_failed = NULL;
+  if (s_app_message_open)
+  {
+    host_heap_used -= host_inbox_size + host_outbox_size + 2 * HOST_HEAP_HEADER;
+  }
+  s_app_message_open = false;
+  s_outbox_begun = false;
+  s_outbox_in_flight = false;
+  s_top_window = NULL;
+
+  s_exit_requested = false;
+  host_run(until_ms);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for the SDK's worker header. The worker only uses what
+// pebble.h already declares; pebble_host.c tells the two apart.
+#include "pebble.h"
@@ -0,0 +1,809 @@
+// Host-side simulator for the AllInfoAsText watchface.
+//
+// Runs src/*.c against the Pebble stand-in in pebble_host.c over a
+// simulated multi-day timeline (taps, app switches, bluetooth drops,
+// battery drain and a phone that answers weather requests the way
+// weatherStream.js does) and turns the counted work into an estimated
+// energy budget per day.
+
+#include <getopt.h>
+
+#include "host.h"
+#include "../src/config.h"
+#include "../src/counters.h"
+#include "../src/memory.h"
+#include "../src/weather.h"
+
+// The watchface's and the worker's own main(), renamed at compile time
+// by the Makefile.
+int pebble_app_main(void);
+int pebble_worker_main(void);
+
+// AppMessage keys, as declared in appinfo.json.
+#define KEY_REQUEST_WEATHER 0
+#define KEY_WEATHER 20
+#define KEY_REQUEST_COUNTERS 21
+#define KEY_COUNTERS 22
+
+// Power model. All costs are in microcoulombs (uA * s). The constants are
+// rough, but they are calibrated against the battery life observed on a
+// real watch (see accel_tap_handler in src/main.c): about 5 days when the
+// face updates once per minute and barely 3 days with seconds shown all
+// the time. What matters is that the same work always costs the same, so
+// a change in the totals means the app changed what it does.
+#define POWER_BATTERY_CAPACITY_MAH 130.0
+#define POWER_BASELINE_UA 1060.0       // Sleep, display hold and BT idle.
+#define POWER_WAKEUP_UC 240.0          // Waking the CPU for any app event.
+#define POWER_FRAME_UC 190.0           // Rendering and pushing one frame...
+#define POWER_LAYER_VISIT_UC 2.0       // ...plus per layer traversed.
+#define POWER_TEXT_SET_UC 80.0         // Per text_layer_set_text.
+#define POWER_FONT_SET_UC 40.0         // Per text_layer_set_font.
+#define POWER_PERSIST_WRITE_UC 400.0   // Flash program per write...
+#define POWER_PERSIST_BYTE_UC 4.0      // ...plus per byte written.
+#define POWER_PERSIST_READ_UC 20.0
+#define POWER_OUTBOX_SEND_UC 4000.0    // Radio wakeup and transmit.
+#define POWER_INBOX_MESSAGE_UC 3000.0  // Radio wakeup and receive...
+#define POWER_INBOX_BYTE_UC 10.0       // ...plus per byte received.
+
+typedef struct {
+  int days;
+  time_t start;
+  int taps_per_day;
+  int app_switches_per_day;
+  int away_minutes;
+  int battery_step_hours;
+  int phone_latency_ms;
+  bool bluetooth_drops;
+  int phone_offline_hours;
+  double max_mah_per_day;
+  int min_heap_free;
+  int max_stack;
+  const char *snapshot_dir;
+  int snapshot_minutes;
+  bool worker;
+  int worker_start_ms;
+  int config_hours;
+  int clock_style_hours;
+} Scenario;
+
+static Scenario s_scenario = {
+  .days = 7,
+  .start = 1425254400, // Monday 2015-03-02 00:00 UTC.
+  .taps_per_day = 12,
+  .app_switches_per_day = 4,
+  .away_minutes = 3,
+  .battery_step_hours = 16,
+  .phone_latency_ms = 3000,
+  .bluetooth_drops = true,
+  .max_mah_per_day = 0,
+  .snapshot_minutes = 60,
+  .worker = true,
+  .worker_start_ms = 200,
+};
+
+static int64_t day_start_ms(int day)
+{
+  return host_start_ms + (int64_t)day * 86400000;
+}
+
+static int64_t hours_ms(double hours)
+{
+  return (int64_t)(hours * 3600000.0);
+}
+
+// Phone model. Mirrors weatherStream.js: every weather request from the
+// watch looks up the location and then the weather cache, both of which
+// may be answered from localStorage.
+// Unless the weather cache is fresh, one OpenWeatherMap request follows
+// for whatever parts are due, answered as one weather message.
+
+// OpenWeatherMap condition ids for the current weather and the forecast.
+static const uint16_t s_current_conditions[] = {
+  800, 801, 802, 803, 500, 501, 600, 701,
+};
+
+static const uint16_t s_forecast_conditions[] = {
+  800, 803, 500, 600, 701,
+};
+
+// Deterministic weather so that every run sees the same payloads.
+static int weather_hash(int64_t value)
+{
+  uint32_t x = (uint32_t)(value * 2654435761u);
+  x ^= x >> 15;
+  return (int)(x % 1000);
+}
+
+static void put_uint16(uint8_t *data, uint16_t value)
+{
+  data[0] = value;
+  data[1] = value >> 8;
+}
+
+static void put_uint32(uint8_t *data, uint32_t value)
+{
+  put_uint16(&data[0], value);
+  put_uint16(&data[2], value >> 16);
+}
+
+static void phone_deliver(const uint8_t *message)
+{
+  uint8_t buffer[1 + sizeof(Tuple) + WEATHER_MESSAGE_SIZE];
+  DictionaryIterator iter;
+  host_dict_begin(&iter, buffer, sizeof(buffer));
+  dict_write_data(&iter, KEY_WEATHER, message, WEATHER_MESSAGE_SIZE);
+  host_deliver_inbox(&iter);
+}
+
+// The weather cache in weatherStream.js: the last fetched message and
+// when it was fetched. The simulated phone never moves, so the cached
+// location always matches.
+#define PHONE_CACHE_TTL_MS (25 * 60 * 1000)
+#define PHONE_CACHE_LATENCY_MS 500 // Location fix and a localStorage read.
+
+static uint8_t s_phone_cache[WEATHER_MESSAGE_SIZE];
+static int64_t s_phone_cache_ms = -1;
+
+// The location cache in weatherStream.js: a fix is only requested once
+// the last one is LOCATION_REUSE_MINUTES, 7 hours, old.
+#define PHONE_LOCATION_REUSE_MS (7 * 60 * 60 * 1000)
+
+static int64_t s_phone_location_ms = -1;
+
+static uint32_t s_phone_location_fixes;
+static uint32_t s_phone_fetches;
+static uint32_t s_phone_cache_hits;
+static uint32_t s_phone_cache_stale;
+static uint32_t s_phone_cache_misses;
+
+static void phone_fetch_done(void *data)
+{
+  uint8_t *message = s_phone_cache;
+  int64_t hour = host_now_ms / 3600000;
+  message[0] = WEATHER_PROTOCOL_VERSION;
+  message[1] = WEATHER_HAS_CURRENT | WEATHER_HAS_FORECAST | WEATHER_HAS_HOURLY;
+  put_uint16(&message[2], 5 + weather_hash(hour) % 15);
+  put_uint16(&message[4], weather_hash(hour + 2) % 360);
+  put_uint16(&message[6], s_current_conditions[weather_hash(hour + 3) % 8]);
+  message[8] = weather_hash(hour + 1) % 12;
+
+  // OpenWeatherMap daily entries are stamped at midday.
+  time_t now = host_time(NULL);
+  struct tm midday = *localtime(&now);
+  midday.tm_hour = 12;
+  midday.tm_min = 0;
+  midday.tm_sec = 0;
+  time_t day1 = mktime(&midday);
+
+  for (int day = 0; day < WEATHER_FORECAST_DAYS; day++)
+  {
+    uint8_t *entry = &message[9 + day * WEATHER_DAY_SIZE];
+    int64_t stamp = day1 + day * 86400;
+    int low = weather_hash(stamp / 86400) % 10;
+    put_uint32(&entry[0], (uint32_t)stamp);
+    put_uint16(&entry[4], s_forecast_conditions[weather_hash(stamp / 86400 + 7) % 5]);
+    entry[6] = low;
+    entry[7] = low + 4 + weather_hash(stamp) % 8;
+  }
+
+  // The hourly forecast agrees with the current temperature sent for
+  // each hour, so the watch's estimates can be checked against it.
+  uint8_t *hourly = &message[WEATHER_HOURLY_OFFSET];
+  put_uint32(&hourly[0], (uint32_t)(hour * 3600));
+  int previous = 5 + weather_hash(hour) % 15;
+  hourly[4] = (uint8_t)previous;
+  for (int h = 1; h < HOURLY_HOURS; h++)
+  {
+    int temperature = 5 + weather_hash(hour + h) % 15;
+    hourly[4 + h] = (uint8_t)(int8_t)(temperature - previous);
+    previous = temperature;
+  }
+
+  s_phone_cache_ms = host_now_ms;
+  phone_deliver(s_phone_cache);
+}
+
+static void phone_send_cached(void *data)
+{
+  phone_deliver(s_phone_cache);
+}
+
+// watch_has_weather is false when the watch has nothing to show yet.
+static void phone_get_weather(bool watch_has_weather)
+{
+  if (!bluetooth_connection_service_peek())
+  {
+    return;
+  }
+
+  if ((s_phone_location_ms < 0) || (host_now_ms - s_phone_location_ms >= PHONE_LOCATION_REUSE_MS))
+  {
+    s_phone_location_fixes++;
+    s_phone_location_ms = host_now_ms;
+  }
+
+  if (s_phone_cache_ms >= 0)
+  {
+    if (host_now_ms - s_phone_cache_ms < PHONE_CACHE_TTL_MS)
+    {
+      s_phone_cache_hits++;
+      host_schedule(host_now_ms + PHONE_CACHE_LATENCY_MS, phone_send_cached, NULL, true);
+      return;
+    }
+    s_phone_cache_stale++;
+    if (!watch_has_weather)
+    {
+      host_schedule(host_now_ms + PHONE_CACHE_LATENCY_MS, phone_send_cached, NULL, true);
+    }
+  }
+  else
+  {
+    s_phone_cache_misses++;
+  }
+
+  s_phone_fetches++;
+  // The phone has no data connection for the first hours of the run:
+  // requests reach it but nothing comes back.
+  if (host_now_ms < host_start_ms + hours_ms(s_scenario.phone_offline_hours))
+  {
+    return;
+  }
+  // The round trip, then parsing what came back.
+  host_schedule(host_now_ms + s_scenario.phone_latency_ms + 250, phone_fetch_done, NULL, true);
+}
+
+// The watch's counters, asked for at launch at most once a day, as
+// weatherStream.js does. The last ones received are shown in the report.
+#define PHONE_COUNTERS_INTERVAL_MS (24 * 60 * 60 * 1000)
+
+static const char *const s_counter_names[COUNTER_COUNT] = {
+  "launches", "second ticks", "minute ticks", "text updates", "inbox messages", "inbox bytes",
+  "inbox dropped", "outbox sent", "outbox failed", "persist writes", "seconds shown",
+};
+
+static int64_t s_phone_counters_ms = -1;
+static uint32_t s_phone_counters[COUNTER_COUNT];
+static uint32_t s_phone_counter_messages;
+
+static void phone_request_counters(void *data)
+{
+  uint8_t buffer[16];
+  DictionaryIterator iter;
+  host_dict_begin(&iter, buffer, sizeof(buffer));
+  dict_write_uint8(&iter, KEY_REQUEST_COUNTERS, 1);
+  host_deliver_inbox(&iter);
+}
+
+static void phone_receive_counters(const Tuple *tuple)
+{
+  const uint8_t *data = tuple->value->data;
+  if ((tuple->length != COUNTERS_MESSAGE_SIZE) || (data[0] != COUNTERS_PROTOCOL_VERSION))
+  {
+    return;
+  }
+  for (int counter = 0; counter < COUNTER_COUNT; counter++)
+  {
+    const uint8_t *value = &data[2 + counter * 4];
+    s_phone_counters[counter] = value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24);
+  }
+  s_phone_counters_ms = host_now_ms;
+  s_phone_counter_messages++;
+}
+
+// The 'ready' event at launch. The watch asks for the weather itself
+// once it is due.
+static void phone_on_launch(void)
+{
+  if (bluetooth_connection_service_peek() &&
+      ((s_phone_counters_ms < 0) || (host_now_ms - s_phone_counters_ms >= PHONE_COUNTERS_INTERVAL_MS)))
+  {
+    host_schedule(host_now_ms + PHONE_CACHE_LATENCY_MS, phone_request_counters, NULL, true);
+  }
+}
+
+static void phone_on_outbox(DictionaryIterator *iter)
+{
+  Tuple *counters = dict_find(iter, KEY_COUNTERS);
+  if (counters)
+  {
+    phone_receive_counters(counters);
+    return;
+  }
+  Tuple *request = dict_find(iter, KEY_REQUEST_WEATHER);
+  phone_get_weather(!request || (request->value->uint8 == 0));
+}
+
+// The settings page. Every config_hours the user changes one setting,
+// each in turn, and closes the page; weatherStream.js then sends every
+// setting as the watch stores it, with the schema version. The text
+// updates each change costs the watch are counted per setting.
+static const char *const s_config_names[CONFIG_SETTING_COUNT] = {
+  "temperature units", "wind units", "week number", "week start",
+};
+static const uint8_t s_config_counts[CONFIG_SETTING_COUNT] = { 2, 4, 2, 2 };
+static const int s_config_order[CONFIG_SETTING_COUNT] = { 1, 2, 3, 0 };
+
+static uint8_t s_phone_config[CONFIG_SETTING_COUNT]; // As the watch starts, all 0.
+static int s_phone_config_changes;
+static uint32_t s_phone_config_messages[CONFIG_SETTING_COUNT];
+static uint32_t s_phone_config_text_updates[CONFIG_SETTING_COUNT];
+
+static void phone_send_config(void *data)
+{
+  host_schedule(host_now_ms + hours_ms(s_scenario.config_hours), phone_send_config, NULL, false);
+
+  int setting = s_config_order[s_phone_config_changes % CONFIG_SETTING_COUNT];
+  uint8_t value = (s_phone_config[setting] + 1) % s_config_counts[setting];
+
+  uint8_t buffer[128];
+  DictionaryIterator iter;
+  host_dict_begin(&iter, buffer, sizeof(buffer));
+  dict_write_int32(&iter, CONFIG_KEY_VERSION, CONFIG_SCHEMA_VERSION);
+  for (int key = 0; key < CONFIG_SETTING_COUNT; key++)
+  {
+    dict_write_int32(&iter, CONFIG_KEY_TEMPERATURE_UNITS + key, (key == setting) ? value : s_phone_config[key]);
+  }
+
+  // The page can only be opened while the face runs. A change that
+  // doesn't reach the watch is made again next time.
+  uint32_t text_updates = counterValues[COUNTER_TEXT_UPDATES];
+  if (!host_app_running() || !host_deliver_inbox(&iter))
+  {
+    return;
+  }
+  s_phone_config[setting] = value;
+  s_phone_config_changes++;
+  s_phone_config_messages[setting]++;
+  s_phone_config_text_updates[setting] += counterValues[COUNTER_TEXT_UPDATES] - text_updates;
+}
+
+// Scenario events. Each one reschedules its next occurrence.
+
+static void scenario_tap(void *data)
+{
+  host_tap();
+
+  // Taps are spread evenly over waking hours (07:00 to 22:00).
+  intptr_t index = (intptr_t)data + 1;
+  int day = (int)(index / s_scenario.taps_per_day);
+  int slot = (int)(index % s_scenario.taps_per_day);
+  int64_t when = day_start_ms(day) + hours_ms(7.0 + 15.0 * slot / s_scenario.taps_per_day);
+  host_schedule(when, scenario_tap, (void *)index, false);
+}
+
+static void scenario_app_switch(void *data)
+{
+  host_request_app_exit();
+
+  intptr_t index = (intptr_t)data + 1;
+  int day = (int)(index / s_scenario.app_switches_per_day);
+  int slot = (int)(index % s_scenario.app_switches_per_day);
+  int64_t when = day_start_ms(day) + hours_ms(8.5 + 13.0 * slot / s_scenario.app_switches_per_day);
+  host_schedule(when, scenario_app_switch, (void *)index, false);
+}
+
+// The user switches between a 12 and 24 hour clock in the watch's
+// settings every clock_style_hours, while the face keeps running.
+static void scenario_clock_style(void *data)
+{
+  host_clock_24h = !host_clock_24h;
+  host_schedule(host_now_ms + hours_ms(s_scenario.clock_style_hours), scenario_clock_style, NULL, false);
+}
+
+static void scenario_bluetooth(void *data)
+{
+  host_set_bluetooth(data != NULL);
+}
+
+static void scenario_battery(void *data)
+{
+  BatteryChargeState state = battery_state_service_peek();
+  int64_t next_ms = hours_ms(s_scenario.battery_step_hours);
+
+  if (state.is_charging)
+  {
+    if (state.charge_percent >= 100)
+    {
+      state.is_charging = false;
+      state.is_plugged = false;
+    }
+    else
+    {
+      state.charge_percent += 10;
+      next_ms = hours_ms(0.25);
+    }
+  }
+  else if (state.charge_percent <= 10)
+  {
+    // Put it on the charger once it runs low.
+    state.is_charging = true;
+    state.is_plugged = true;
+    next_ms = hours_ms(0.25);
+  }
+  else
+  {
+    state.charge_percent -= 10;
+  }
+
+  host_set_battery(state);
+  host_schedule(host_now_ms + next_ms, scenario_battery, NULL, false);
+}
+
+// Snapshots of the display, named after the day and local time, 30
+// seconds into each period so the minute's tick has been drawn.
+static void scenario_snapshot(void *data)
+{
+  intptr_t index = (intptr_t)data;
+  if (host_app_running())
+  {
+    time_t now = host_time(NULL);
+    char stamp[16];
+    strftime(stamp, sizeof(stamp), "%H%M", localtime(&now));
+    char path[512];
+    snprintf(path, sizeof(path), "%s/day%d-%s.png", s_scenario.snapshot_dir, host_day_index() + 1, stamp);
+    if (!host_write_png(path))
+    {
+      fprintf(stderr, "sim: cannot write %s\n", path);
+    }
+  }
+
+  index++;
+  int64_t when = host_start_ms + index * s_scenario.snapshot_minutes * 60000LL + 30000;
+  host_schedule(when, scenario_snapshot, (void *)index, false);
+}
+
+static void scenario_init(void)
+{
+  if (s_scenario.taps_per_day > 0)
+  {
+    host_schedule(day_start_ms(0) + hours_ms(7.0), scenario_tap, (void *)0, false);
+  }
+  if (s_scenario.app_switches_per_day > 0)
+  {
+    host_schedule(day_start_ms(0) + hours_ms(8.5), scenario_app_switch, (void *)0, false);
+  }
+  if (s_scenario.battery_step_hours > 0)
+  {
+    host_schedule(host_start_ms + hours_ms(s_scenario.battery_step_hours), scenario_battery, NULL, false);
+  }
+  if (s_scenario.bluetooth_drops)
+  {
+    // A short drop over lunch every day (phone left on the desk) and one
+    // long overnight outage on the fourth night (phone switched off).
+    for (int day = 0; day < s_scenario.days; day++)
+    {
+      host_schedule(day_start_ms(day) + hours_ms(12.5), scenario_bluetooth, NULL, false);
+      host_schedule(day_start_ms(day) + hours_ms(13.25), scenario_bluetooth, (void *)1, false);
+    }
+    if (s_scenario.days > 3)
+    {
+      host_schedule(day_start_ms(3) + hours_ms(23.0), scenario_bluetooth, NULL, false);
+      host_schedule(day_start_ms(4) + hours_ms(7.0), scenario_bluetooth, (void *)1, false);
+    }
+  }
+
+  if (s_scenario.snapshot_dir)
+  {
+    host_schedule(host_start_ms + 30000, scenario_snapshot, (void *)0, false);
+  }
+  if (s_scenario.config_hours > 0)
+  {
+    host_schedule(host_start_ms + hours_ms(s_scenario.config_hours) + 15000, phone_send_config, NULL, false);
+  }
+  if (s_scenario.clock_style_hours > 0)
+  {
+    host_schedule(host_start_ms + hours_ms(s_scenario.clock_style_hours) + 20000, scenario_clock_style, NULL, false);
+  }
+
+  host_phone_on_outbox = phone_on_outbox;
+  host_phone_on_launch = phone_on_launch;
+}
+
+// Report
+
+static double day_charge_uc(const HostCounters *c)
+{
+  return POWER_BASELINE_UA * 86400.0
+      + c->wakeups * POWER_WAKEUP_UC
+      + c->frames * POWER_FRAME_UC
+      + c->layer_visits * POWER_LAYER_VISIT_UC
+      + c->text_set * POWER_TEXT_SET_UC
+      + c->font_set * POWER_FONT_SET_UC
+      + c->persist_writes * POWER_PERSIST_WRITE_UC
+      + c->persist_write_bytes * POWER_PERSIST_BYTE_UC
+      + c->persist_reads * POWER_PERSIST_READ_UC
+      + c->outbox_sends * POWER_OUTBOX_SEND_UC
+      + c->inbox_messages * POWER_INBOX_MESSAGE_UC
+      + c->inbox_bytes * POWER_INBOX_BYTE_UC;
+}
+
+static double uc_to_mah(double uc)
+{
+  return uc / 3600.0 / 1000.0;
+}
+
+static void add_counters(HostCounters *total, const HostCounters *day)
+{
+  const uint32_t *src = (const uint32_t *)day;
+  uint32_t *dst = (uint32_t *)total;
+  for (size_t i = 0; i < sizeof(HostCounters) / sizeof(uint32_t); i++)
+  {
+    dst[i] += src[i];
+  }
+}
+
+static void print_row(const char *label, const HostCounters *c, double mah)
+{
+  printf("%-5s %7u %6u %6u %6u %6u %7u %5u/%-5u %5u/%-3u %4u/%-6u %8.2f\n",
+         label,
+         c->ticks_second, c->ticks_minute, c->wakeups,
+         c->text_set, c->font_set, c->frames,
+         c->persist_writes, c->persist_write_bytes,
+         c->outbox_sends, c->outbox_failed,
+         c->inbox_messages, c->inbox_bytes,
+         mah);
+}
+
+static double report(void)
+{
+  char start[32];
+  strftime(start, sizeof(start), "%Y-%m-%d %H:%M %Z", localtime(&s_scenario.start));
+  printf("AllInfoAsText host simulation: %d days from %s, %s clock\n",
+         s_scenario.days, start, host_clock_24h ? "24h" : "12h");
+  printf("%-5s %7s %6s %6s %6s %6s %7s %11s %9s %11s %8s\n",
+         "day", "sec", "min", "wake", "text", "font", "frames",
+         "persist/B", "out/fail", "in/bytes", "mAh");
+
+  HostCounters total;
+  memset(&total, 0, sizeof(total));
+  double total_mah = 0;
+  for (int day = 0; day < s_scenario.days; day++)
+  {
+    char label[8];
+    snprintf(label, sizeof(label), "%d", day + 1);
+    double mah = uc_to_mah(day_charge_uc(&host_day_counters[day]));
+    print_row(label, &host_day_counters[day], mah);
+    add_counters(&total, &host_day_counters[day]);
+    total_mah += mah;
+  }
+  print_row("total", &total, total_mah);
+
+  double mah_per_day = total_mah / s_scenario.days;
+  double app_mah_per_day = mah_per_day - uc_to_mah(POWER_BASELINE_UA * 86400.0);
+  printf("\naverage %.2f mAh/day (%.2f mAh/day above baseline), "
+         "estimated battery life %.1f days on %.0f mAh\n",
+         mah_per_day, app_mah_per_day,
+         POWER_BATTERY_CAPACITY_MAH / mah_per_day, POWER_BATTERY_CAPACITY_MAH);
+  printf("launches %u, taps %u, dirty layers %u, persist reads %u, inbox dropped %u, worker wakeups %u\n",
+         total.launches, total.taps, total.dirty_layers, total.persist_reads, total.inbox_dropped,
+         total.worker_wakeups);
+  uint32_t ticks = total.ticks_second + total.ticks_minute;
+  printf("layer text updates per tick %.2f, dirty layers per frame %.2f\n",
+         ticks ? (double)total.tick_text_set / ticks : 0.0,
+         total.frames ? (double)total.dirty_layers / total.frames : 0.0);
+  printf("layers traversed per frame %.2f, text draws per frame %.2f, peak layers allocated %d\n",
+         total.frames ? (double)total.layer_visits / total.frames : 0.0,
+         total.frames ? (double)total.text_draws / total.frames : 0.0,
+         host_layers_peak);
+  printf("damage per frame %.0f pixels in %.1f rows, %.0f pixels changed; damage per tick frame %.0f pixels\n",
+         total.frames ? (double)total.damage_pixels / total.frames : 0.0,
+         total.frames ? (double)total.damage_rows / total.frames : 0.0,
+         total.frames ? (double)total.changed_pixels / total.frames : 0.0,
+         total.tick_frames ? (double)total.tick_damage_pixels / total.tick_frames : 0.0);
+  if (host_first_frame.launches)
+  {
+    double launches = host_first_frame.launches;
+    printf("first frame per launch: %.1f persist reads, %.1f text sets, %.1f localtime calls, "
+           "host %.0f us (max %.0f us)\n",
+           host_first_frame.persist_reads / launches, host_first_frame.text_set / launches,
+           host_first_frame.localtime_calls / launches, host_first_frame.host_ns / launches / 1000.0,
+           host_first_frame.host_ns_max / 1000.0);
+  }
+  printf("app message buffers: inbox %u bytes, outbox %u bytes\n", host_inbox_size, host_outbox_size);
+  printf("app heap: peak %u of %d bytes\n", host_heap_peak, HOST_HEAP_SIZE);
+  printf("%-12s %8s %10s %10s %10s %10s %8s\n",
+         "memory", "samples", "heap used", "peak", "free", "free low", "stack");
+  for (int phase = 0; phase < MEMORY_PHASE_COUNT; phase++)
+  {
+    const MemoryRecord *record = memory_record(phase);
+    printf("%-12s %8u %10u %10u %10u %10u %7u%s\n", memory_phase_name(phase), record->samples,
+           record->heapUsed, record->heapUsedPeak, record->heapFree, record->heapFreeLow, record->stackPeak,
+           (record->stackPeak >= MEMORY_STACK_PAINT_BYTES) ? "+" : " ");
+  }
+  printf("phone: %u location fixes, %u weather fetches, cache %u hits, %u stale, %u misses\n",
+         s_phone_location_fixes, s_phone_fetches, s_phone_cache_hits, s_phone_cache_stale, s_phone_cache_misses);
+  if (s_phone_config_changes)
+  {
+    printf("settings changed %d times, text updates per change:", s_phone_config_changes);
+    for (int setting = 0; setting < CONFIG_SETTING_COUNT; setting++)
+    {
+      if (s_phone_config_messages[setting])
+      {
+        printf(" %s %.1f", s_config_names[setting],
+               (double)s_phone_config_text_updates[setting] / s_phone_config_messages[setting]);
+      }
+    }
+    printf("\n");
+  }
+  if (s_phone_counters_ms >= 0)
+  {
+    printf("watch counters (%u messages, last on day %d):",
+           s_phone_counter_messages, (int)((s_phone_counters_ms - host_start_ms) / 86400000) + 1);
+    for (int counter = 0; counter < COUNTER_COUNT; counter++)
+    {
+      printf("%s %s %u", counter ? "," : "", s_counter_names[counter], s_phone_counters[counter]);
+    }
+    printf("\n");
+  }
+  return mah_per_day;
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --days N               simulated days (default 7, max %d)\n"
+          "  --start EPOCH          start time in seconds (default 1425254400)\n"
+          "  --tz ZONE              time zone for localtime (default UTC)\n"
+          "  --24h                  report a 24 hour clock to the app\n"
+          "  --switch-24h-hours N   switch between a 12 and 24 hour clock every N hours (default 0 = never)\n"
+          "  --taps N               wrist taps per day (default 12)\n"
+          "  --app-switches N       app switches per day (default 4)\n"
+          "  --away-minutes N       minutes spent in the other app (default 3)\n"
+          "  --battery-step-hours N hours per 10%% of battery (default 16, 0 = off)\n"
+          "  --phone-latency-ms N   phone round trip for a weather fetch (default 3000)\n"
+          "  --no-bluetooth-drops   keep the phone connected the whole time\n"
+          "  --offline-hours N      phone answers nothing for the first N hours\n"
+          "  --nack-every N         every Nth message to the phone is not acked\n"
+          "  --no-worker            run the face without its background worker\n"
+          "  --worker-start-ms N    time the worker takes to start after launch (default 200)\n"
+          "  --events-first         handle events already due at launch before the first frame\n"
+          "  --config-every-hours N change one setting every N hours (default 0 = never)\n"
+          "  --max-mah-per-day X    exit with status 1 if the average exceeds X\n"
+          "  --min-heap-free N      exit with status 1 if the app heap ever had less than N bytes free\n"
+          "  --max-stack N          exit with status 1 if any phase used more than N bytes of stack\n"
+          "  --snapshot-dir DIR     write the display as DIR/dayN-HHMM.png\n"
+          "  --snapshot-every N     minutes between snapshots (default 60)\n"
+          "  --damage-log FILE      write the damage of every frame to FILE\n"
+          "  --verbose              print APP_LOG output\n",
+          argv0, HOST_MAX_DAYS);
+}
+
+int main(int argc, char **argv)
+{
+  const char *tz = "UTC";
+  const char *damage_log = NULL;
+  static struct option options[] = {
+    { "days", required_argument, NULL, 'd' },
+    { "start", required_argument, NULL, 's' },
+    { "tz", required_argument, NULL, 'z' },
+    { "24h", no_argument, NULL, 'H' },
+    { "switch-24h-hours", required_argument, NULL, 'T' },
+    { "taps", required_argument, NULL, 't' },
+    { "app-switches", required_argument, NULL, 'a' },
+    { "away-minutes", required_argument, NULL, 'w' },
+    { "battery-step-hours", required_argument, NULL, 'b' },
+    { "phone-latency-ms", required_argument, NULL, 'l' },
+    { "no-bluetooth-drops", no_argument, NULL, 'n' },
+    { "offline-hours", required_argument, NULL, 'o' },
+    { "nack-every", required_argument, NULL, 'k' },
+    { "no-worker", no_argument, NULL, 'W' },
+    { "worker-start-ms", required_argument, NULL, 'R' },
+    { "events-first", no_argument, NULL, 'e' },
+    { "config-every-hours", required_argument, NULL, 'C' },
+    { "max-mah-per-day", required_argument, NULL, 'm' },
+    { "min-heap-free", required_argument, NULL, 'F' },
+    { "max-stack", required_argument, NULL, 'K' },
+    { "snapshot-dir", required_argument, NULL, 'S' },
+    { "snapshot-every", required_argument, NULL, 'E' },
+    { "damage-log", required_argument, NULL, 'D' },
+    { "verbose", no_argument, NULL, 'v' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 },
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (opt)
+    {
+      case 'd': s_scenario.days = atoi(optarg); break;
+      case 's': s_scenario.start = (time_t)atoll(optarg); break;
+      case 'z': tz = optarg; break;
+      case 'H': host_clock_24h = true; break;
+      case 'T': s_scenario.clock_style_hours = atoi(optarg); break;
+      case 't': s_scenario.taps_per_day = atoi(optarg); break;
+      case 'a': s_scenario.app_switches_per_day = atoi(optarg); break;
+      case 'w': s_scenario.away_minutes = atoi(optarg); break;
+      case 'b': s_scenario.battery_step_hours = atoi(optarg); break;
+      case 'l': s_scenario.phone_latency_ms = atoi(optarg); break;
+      case 'n': s_scenario.bluetooth_drops = false; break;
+      case 'o': s_scenario.phone_offline_hours = atoi(optarg); break;
+      case 'k': host_outbox_nack_every = atoi(optarg); break;
+      case 'W': s_scenario.worker = false; break;
+      case 'R': s_scenario.worker_start_ms = atoi(optarg); break;
+      case 'e': host_events_before_first_frame = true; break;
+      case 'C': s_scenario.config_hours = atoi(optarg); break;
+      case 'm': s_scenario.max_mah_per_day = atof(optarg); break;
+      case 'F': s_scenario.min_heap_free = atoi(optarg); break;
+      case 'K': s_scenario.max_stack = atoi(optarg); break;
+      case 'S': s_scenario.snapshot_dir = optarg; break;
+      case 'E': s_scenario.snapshot_minutes = atoi(optarg); break;
+      case 'D': damage_log = optarg; break;
+      case 'v': host_verbose = true; break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (s_scenario.days < 1 || s_scenario.days > HOST_MAX_DAYS || s_scenario.snapshot_minutes < 1)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if (damage_log)
+  {
+    host_damage_log = fopen(damage_log, "w");
+    if (!host_damage_log)
+    {
+      perror(damage_log);
+      return 2;
+    }
+    fprintf(host_damage_log, "# seconds cause x y w h damage_pixels damage_rows changed_pixels\n");
+  }
+
+  setenv("TZ", tz, 1);
+  tzset();
+
+  host_start_ms = (int64_t)s_scenario.start * 1000;
+  host_end_ms = day_start_ms(s_scenario.days);
+  host_now_ms = host_start_ms;
+  scenario_init();
+  if (s_scenario.worker)
+  {
+    host_worker_main = pebble_worker_main;
+    host_worker_start_ms = s_scenario.worker_start_ms;
+  }
+
+  // Each pass is one launch of the watchface; app switches end a pass
+  // and the face is relaunched after the user comes back.
+  while (host_now_ms < host_end_ms)
+  {
+    host_launch_begin();
+    pebble_app_main();
+    if (host_now_ms < host_end_ms)
+    {
+      int64_t back_ms = host_now_ms + (int64_t)s_scenario.away_minutes * 60000;
+      host_run_away(back_ms < host_end_ms ? back_ms : host_end_ms);
+    }
+  }
+
+  double mah_per_day = report();
+  if (host_damage_log)
+  {
+    fclose(host_damage_log);
+  }
+  int status = 0;
+  if (s_scenario.max_mah_per_day > 0 && mah_per_day > s_scenario.max_mah_per_day)
+  {
+    printf("FAIL: %.2f mAh/day exceeds budget of %.2f mAh/day\n", mah_per_day, s_scenario.max_mah_per_day);
+    status = 1;
+  }
+  if (s_scenario.min_heap_free > 0 && HOST_HEAP_SIZE - (int)host_heap_peak < s_scenario.min_heap_free)
+  {
+    printf("FAIL: %d bytes of heap left at the peak, below %d\n",
+           HOST_HEAP_SIZE - (int)host_heap_peak, s_scenario.min_heap_free);
+    status = 1;
+  }
+  for (int phase = 0; phase < MEMORY_PHASE_COUNT; phase++)
+  {
+    if (s_scenario.max_stack > 0 && (int)memory_record(phase)->stackPeak > s_scenario.max_stack)
+    {
+      printf("FAIL: %s used %u bytes of stack, above %d\n",
+             memory_phase_name(phase), memory_record(phase)->stackPeak, s_scenario.max_stack);
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,150 @@
+#include "calendar.h"
+
+// Date conversions follow Howard Hinnant's days_from_civil and
+// civil_from_days, which only need integer division.
+
+static bool is_leap_year(int year)
+{
+  return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+}
+
+static int days_in_month(int year, int month)
+{
+  static const uint8_t monthLength[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+  if ((month == 2) && is_leap_year(year))
+  {
+    return 29;
+  }
+  return monthLength[month - 1];
+}
+
+int32_t calendar_days_from_civil(int year, int month, int day)
+{
+  year -= (month <= 2);
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  int32_t yearOfEra = year - era * 400;
+  int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+void calendar_civil_from_days(int32_t days, int *year, int *month, int *day)
+{
+  days += 719468;
+  int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int32_t dayOfEra = days - era * 146097;
+  int32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int32_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+  *day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  *month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+  *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+int calendar_day_of_week(int32_t days)
+{
+  // 1970-01-01 was a Thursday.
+  return days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6;
+}
+
+int calendar_week_number(int dayOfYear, int dayOfWeek, bool mondayFirst)
+{
+  int daysSinceWeekStart = mondayFirst ? (dayOfWeek + 6) % 7 : dayOfWeek;
+  return (dayOfYear + 7 - daysSinceWeekStart) / 7;
+}
+
+// Write count consecutive days of the month starting at the grid's next
+// date, and advance the next date past them.
+static void fill_days(CalendarGrid *grid, int firstCell, int count)
+{
+  int year = grid->nextYear;
+  int month = grid->nextMonth;
+  int day = grid->nextDay;
+  int monthLength = days_in_month(year, month);
+
+  for (int cell = firstCell; cell < firstCell + count; cell++)
+  {
+    grid->dayOfMonth[cell] = day;
+    if (++day > monthLength)
+    {
+      day = 1;
+      if (++month > 12)
+      {
+        month = 1;
+        year++;
+      }
+      monthLength = days_in_month(year, month);
+    }
+  }
+
+  grid->nextYear = year;
+  grid->nextMonth = month;
+  grid->nextDay = day;
+}
+
+static void set_today(CalendarGrid *grid, int32_t today)
+{
+  grid->today = today;
+  grid->todayIndex = today - grid->firstDay;
+
+  int dayOfYear = today - grid->yearStart;
+  int yearLength = is_leap_year(grid->year) ? 366 : 365;
+  if (dayOfYear >= yearLength)
+  {
+    grid->year++;
+    grid->yearStart += yearLength;
+    dayOfYear -= yearLength;
+  }
+  grid->weekNumber = calendar_week_number(dayOfYear, calendar_day_of_week(today), grid->mondayFirst);
+}
+
+void calendar_build(CalendarGrid *grid, int32_t today, bool mondayFirst)
+{
+  int dayOfWeek = calendar_day_of_week(today);
+  int daysSinceWeekStart = mondayFirst ? (dayOfWeek + 6) % 7 : dayOfWeek;
+
+  grid->valid = true;
+  grid->mondayFirst = mondayFirst;
+  grid->firstDay = today - daysSinceWeekStart;
+
+  int year, month, day;
+  calendar_civil_from_days(today, &year, &month, &day);
+  grid->year = year;
+  grid->yearStart = calendar_days_from_civil(year, 1, 1);
+
+  calendar_civil_from_days(grid->firstDay, &year, &month, &day);
+  grid->nextYear = year;
+  grid->nextMonth = month;
+  grid->nextDay = day;
+  fill_days(grid, 0, CALENDAR_DAYS);
+
+  set_today(grid, today);
+}
+
+void calendar_update(CalendarGrid *grid, int32_t today, bool mondayFirst)
+{
+  if (grid->valid && (grid->mondayFirst == mondayFirst))
+  {
+    if (today == grid->today)
+    {
+      return;
+    }
+    if (today == grid->today + 1)
+    {
+      if (grid->todayIndex == 6)
+      {
+        // A new week starts: next week becomes this week and one new
+        // week is filled in behind it.
+        memmove(&grid->dayOfMonth[0], &grid->dayOfMonth[7], 7);
+        grid->firstDay += 7;
+        fill_days(grid, 7, 7);
+      }
+      set_today(grid, today);
+      return;
+    }
+  }
+
+  calendar_build(grid, today, mondayFirst);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "sdk.h"
+
+// Integer calendar arithmetic on days since 1970-01-01. The 2-week
+// calendar is built from the date alone, with no localtime or strftime
+// calls, so daylight saving changes can never skip or repeat a day.
+
+#define CALENDAR_DAYS 14
+
+typedef struct
+{
+  bool valid;
+  bool mondayFirst;
+  int32_t today;              // Days since the epoch.
+  int32_t firstDay;           // Days since the epoch of the first cell.
+  int32_t yearStart;          // Days since the epoch of January 1st of today's year.
+  int16_t year;               // Today's year.
+  int16_t nextYear;           // Date of the day after the last cell,
+  uint8_t nextMonth;          // where an incremental shift continues.
+  uint8_t nextDay;
+  uint8_t todayIndex;         // Cell holding today.
+  uint8_t weekNumber;         // Same as strftime %W (Monday first) or %U.
+  uint8_t dayOfMonth[CALENDAR_DAYS];
+} CalendarGrid;
+
+int32_t calendar_days_from_civil(int year, int month, int day);
+void calendar_civil_from_days(int32_t days, int *year, int *month, int *day);
+
+// 0 = Sunday, as tm_wday.
+int calendar_day_of_week(int32_t days);
+
+// Week of the year as strftime %W (mondayFirst) or %U, from tm_yday/tm_wday.
+int calendar_week_number(int dayOfYear, int dayOfWeek, bool mondayFirst);
+
+// Rebuild the whole grid for the week holding today.
+void calendar_build(CalendarGrid *grid, int32_t today, bool mondayFirst);
+
+// Bring the grid up to date for today. Moving on by one day only moves
+// the highlighted cell, or shifts the grid by a week when a new week
+// starts; anything else rebuilds it.
+void calendar_update(CalendarGrid *grid, int32_t today, bool mondayFirst);
@@ -0,0 +1,99 @@
+#include "config.h"
+#include "units.h"
+
+// One row per setting, in key order from CONFIG_KEY_TEMPERATURE_UNITS:
+// where the state keeps it, how many values it has, and what shows it.
+typedef struct
+{
+  uint8_t offset;             // Into PersistedState.
+  uint8_t count;
+  uint8_t views;
+} ConfigSetting;
+
+static const ConfigSetting s_settings[CONFIG_SETTING_COUNT] = {
+  { offsetof(PersistedState, temperatureUnits), 2, CONFIG_VIEW_CURRENT_WEATHER | CONFIG_VIEW_FORECAST },
+  { offsetof(PersistedState, windSpeedUnits), 4, CONFIG_VIEW_CURRENT_WEATHER },
+  { offsetof(PersistedState, weekNumberEnabled), 2, CONFIG_VIEW_SECONDS },
+  // The week number counts from the first day of the week too.
+  { offsetof(PersistedState, mondayFirst), 2, CONFIG_VIEW_CALENDAR | CONFIG_VIEW_SECONDS },
+};
+
+_Static_assert(TEMPERATURE_UNITS_C < 2 && WINDSPEED_UNITS_BEAUFORT < 4, "Setting counts out of date");
+
+// Integer tuples come as 1, 2 or 4 bytes, signed or not. PebbleKit JS
+// sends every number as a 4 byte signed one.
+static bool read_integer(const Tuple *tuple, int32_t *value)
+{
+  bool isSigned = (tuple->type == TUPLE_INT);
+  if (!isSigned && (tuple->type != TUPLE_UINT))
+  {
+    return false;
+  }
+  switch (tuple->length)
+  {
+    case 1:
+      *value = isSigned ? tuple->value->int8 : tuple->value->uint8;
+      return true;
+    case 2:
+      *value = isSigned ? tuple->value->int16 : tuple->value->uint16;
+      return true;
+    case 4:
+      *value = tuple->value->int32;
+      return isSigned || (*value >= 0);
+    default:
+      return false;
+  }
+}
+
+void config_begin(ConfigMessage *message)
+{
+  message->version = -1;
+  message->valid = true;
+  message->present = 0;
+}
+
+bool config_read(ConfigMessage *message, const Tuple *tuple)
+{
+  int32_t value = 0;
+  bool isInteger = read_integer(tuple, &value);
+
+  if (tuple->key == CONFIG_KEY_VERSION)
+  {
+    message->version = isInteger ? value : -1;
+    return true;
+  }
+
+  uint32_t setting = tuple->key - CONFIG_KEY_TEMPERATURE_UNITS;
+  if (setting >= CONFIG_SETTING_COUNT)
+  {
+    return false;
+  }
+  if (!isInteger || (value < 0) || (value >= s_settings[setting].count))
+  {
+    message->valid = false;
+    return true;
+  }
+  message->present |= 1 << setting;
+  message->values[setting] = value;
+  return true;
+}
+
+uint8_t config_apply(const ConfigMessage *message, PersistedState *state)
+{
+  if (!message->valid || (message->version != CONFIG_SCHEMA_VERSION))
+  {
+    return 0;
+  }
+
+  uint8_t views = 0;
+  for (int setting = 0; setting < CONFIG_SETTING_COUNT; setting++)
+  {
+    uint8_t *stored = (uint8_t *)state + s_settings[setting].offset;
+    if ((message->present & (1 << setting)) && (*stored != message->values[setting]))
+    {
+      *stored = message->values[setting];
+      views |= s_settings[setting].views;
+    }
+  }
+  return views;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <pebble.h>
+#include "state.h"
+
+// Configuration message, sent by weatherStream.js when the settings
+// page closes. Every setting is an integer tuple holding the value as
+// the persisted state keeps it (see state.h), and CONFIG_KEY_VERSION
+// carries CONFIG_SCHEMA_VERSION. A message is only applied when its
+// version matches and every setting in it is an integer in range;
+// anything else is ignored as a whole.
+
+#define CONFIG_SCHEMA_VERSION 1
+
+#define CONFIG_KEY_TEMPERATURE_UNITS 50 // TEMPERATURE_UNITS_*, see units.h.
+#define CONFIG_KEY_WINDSPEED_UNITS 51   // WINDSPEED_UNITS_*, see units.h.
+#define CONFIG_KEY_WEEKNUMBER_ENABLED 52 // 0 or 1.
+#define CONFIG_KEY_MONDAY_FIRST 53      // 0 or 1.
+#define CONFIG_KEY_VERSION 54
+
+// What the face shows that depends on a setting. Applying a message
+// returns the views to bring up to date, and nothing else is redrawn.
+#define CONFIG_VIEW_CURRENT_WEATHER (1 << 0)
+#define CONFIG_VIEW_FORECAST (1 << 1)
+#define CONFIG_VIEW_SECONDS (1 << 2)  // The seconds slot, which may show the week number.
+#define CONFIG_VIEW_CALENDAR (1 << 3) // Where the calendar's days go.
+
+#define CONFIG_SETTING_COUNT 4
+
+typedef struct
+{
+  int32_t version;            // -1 until CONFIG_KEY_VERSION is read.
+  bool valid;
+  uint8_t present;            // Bit per setting read, in key order.
+  uint8_t values[CONFIG_SETTING_COUNT];
+} ConfigMessage;
+
+void config_begin(ConfigMessage *message);
+
+// Returns false if the tuple is not a configuration key at all.
+bool config_read(ConfigMessage *message, const Tuple *tuple);
+
+// Stores a valid message's settings in state. Returns the views that
+// depend on the settings that changed: 0 when none did, or the message
+// was not valid.
+uint8_t config_apply(const ConfigMessage *message, PersistedState *state);
@@ -0,0 +1,41 @@
+#include "counters.h"
+
+uint32_t counterValues[COUNTER_COUNT];
+static uint32_t s_savedValues[COUNTER_COUNT];
+
+void counters_load(uint32_t storageKey)
+{
+  // A blob from a build with fewer counters fills the first ones; the
+  // rest start at zero.
+  memset(counterValues, 0, sizeof(counterValues));
+  persist_read_data(storageKey, counterValues, sizeof(counterValues));
+  memcpy(s_savedValues, counterValues, sizeof(s_savedValues));
+}
+
+void counters_save(uint32_t storageKey)
+{
+  if (memcmp(counterValues, s_savedValues, sizeof(counterValues)) == 0)
+  {
+    return;
+  }
+
+  counterValues[COUNTER_PERSIST_WRITES]++;
+  persist_write_data(storageKey, counterValues, sizeof(counterValues));
+  memcpy(s_savedValues, counterValues, sizeof(s_savedValues));
+}
+
+void counters_encode(uint8_t *data)
+{
+  data[0] = COUNTERS_PROTOCOL_VERSION;
+  data[1] = COUNTER_COUNT;
+  uint8_t *value = &data[2];
+  for (int counter = 0; counter < COUNTER_COUNT; counter++)
+  {
+    uint32_t count = counterValues[counter];
+    value[0] = count;
+    value[1] = count >> 8;
+    value[2] = count >> 16;
+    value[3] = count >> 24;
+    value += 4;
+  }
+}
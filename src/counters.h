@@ -0,0 +1,49 @@
+#pragma once
+
+#include <pebble.h>
+
+// Counters of the work the watch face does in the field. They are kept
+// across launches and sent to the phone when it asks. Counting is a
+// single add into a RAM array, so they stay enabled in every build.
+//
+// Counters message, one byte array under KEY_COUNTERS. Little-endian:
+//
+//   offset  size  field
+//   0       1     COUNTERS_PROTOCOL_VERSION
+//   1       1     number of counters, COUNTER_COUNT
+//   2       4     each counter in CounterId order, unsigned
+
+#define COUNTERS_PROTOCOL_VERSION 1
+
+// Only ever add counters at the end, so old readers keep working.
+typedef enum
+{
+  COUNTER_LAUNCHES,
+  COUNTER_SECOND_TICKS,
+  COUNTER_MINUTE_TICKS,
+  COUNTER_TEXT_UPDATES,
+  COUNTER_INBOX_MESSAGES,
+  COUNTER_INBOX_BYTES,
+  COUNTER_INBOX_DROPPED,
+  COUNTER_OUTBOX_SENT,
+  COUNTER_OUTBOX_FAILED,
+  COUNTER_PERSIST_WRITES,
+  COUNTER_SECONDS_SHOWN,      // Seconds spent in seconds mode.
+  COUNTER_COUNT,
+} CounterId;
+
+#define COUNTERS_MESSAGE_SIZE (2 + COUNTER_COUNT * 4)
+
+extern uint32_t counterValues[COUNTER_COUNT];
+
+static inline void counters_add(CounterId counter, uint32_t amount)
+{
+  counterValues[counter] += amount;
+}
+
+// Counters are stored under one persist key. Saving only writes to
+// flash if they changed since they were loaded or last saved.
+void counters_load(uint32_t storageKey);
+void counters_save(uint32_t storageKey);
+
+void counters_encode(uint8_t *data);
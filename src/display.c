@@ -0,0 +1,54 @@
+#include "display.h"
+
+#define DISPLAY_HEADER_SIZE offsetof(DisplaySnapshot, text)
+
+void display_begin(DisplaySnapshot *display, int32_t day, bool mondayFirst, int todayIndex)
+{
+  memset(display, 0, DISPLAY_HEADER_SIZE);
+  display->version = DISPLAY_VERSION;
+  display->day = day;
+  display->mondayFirst = mondayFirst;
+  display->todayIndex = todayIndex;
+}
+
+bool display_add(DisplaySnapshot *display, const char *text)
+{
+  if (display->version != DISPLAY_VERSION)
+  {
+    return false;
+  }
+  size_t size = strlen(text) + 1;
+  if (display->length + size > DISPLAY_TEXT_SIZE)
+  {
+    display->version = 0;
+    return false;
+  }
+  memcpy(&display->text[display->length], text, size);
+  display->length += size;
+  return true;
+}
+
+size_t display_size(const DisplaySnapshot *display)
+{
+  return (display->version == DISPLAY_VERSION) ? DISPLAY_HEADER_SIZE + display->length : 0;
+}
+
+bool display_valid(const DisplaySnapshot *display, int size)
+{
+  return (size >= (int)DISPLAY_HEADER_SIZE) &&
+         (display->version == DISPLAY_VERSION) &&
+         (display->length <= DISPLAY_TEXT_SIZE) &&
+         (size == (int)(DISPLAY_HEADER_SIZE + display->length)) &&
+         ((display->length == 0) || (display->text[display->length - 1] == 0));
+}
+
+const char *display_next(const DisplaySnapshot *display, size_t *offset)
+{
+  if (*offset >= display->length)
+  {
+    return NULL;
+  }
+  const char *text = &display->text[*offset];
+  *offset += strlen(text) + 1;
+  return text;
+}
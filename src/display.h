@@ -0,0 +1,41 @@
+#pragma once
+
+#include <pebble.h>
+
+// What the face last showed, kept so the next launch can draw its first
+// frame without working anything out: the text of every field, in
+// field order, and the day it is good for. The time fields are left
+// empty, as the time is always worked out again. Only the bytes used
+// are written to flash.
+
+#define DISPLAY_VERSION 1
+#define DISPLAY_TEXT_SIZE 232
+
+typedef struct
+{
+  uint16_t version;
+  uint16_t length;            // Bytes of text used.
+  int32_t day;                // Local date it was shown on, in days since the epoch.
+  uint8_t mondayFirst;        // 0 = FALSE, 1 = TRUE, for the calendar's frames.
+  uint8_t todayIndex;         // The calendar cell in bold.
+  uint8_t reserved[2];
+  char text[DISPLAY_TEXT_SIZE]; // Each field's text in turn, each ending in a 0.
+} DisplaySnapshot;
+
+_Static_assert(sizeof(DisplaySnapshot) <= PERSIST_DATA_MAX_LENGTH, "DisplaySnapshot does not fit in one persist key");
+
+void display_begin(DisplaySnapshot *display, int32_t day, bool mondayFirst, int todayIndex);
+
+// Returns false, and leaves the snapshot unusable, once the text no
+// longer fits.
+bool display_add(DisplaySnapshot *display, const char *text);
+
+// Bytes to write, or 0 if the snapshot is unusable.
+size_t display_size(const DisplaySnapshot *display);
+
+// Whether size bytes read back from flash are a whole snapshot.
+bool display_valid(const DisplaySnapshot *display, int size);
+
+// The text after the one at *offset, starting from offset 0. NULL past
+// the last one.
+const char *display_next(const DisplaySnapshot *display, size_t *offset);
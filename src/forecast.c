@@ -0,0 +1,30 @@
+#include "forecast.h"
+#include "calendar.h"
+
+static ForecastDay *forecast_slot(ForecastRing *ring, int32_t day)
+{
+  int32_t index = day % FORECAST_DAYS;
+  return &ring->days[index < 0 ? index + FORECAST_DAYS : index];
+}
+
+void forecast_store(ForecastRing *ring, int32_t day, int low_c, int high_c, uint8_t conditions)
+{
+  ForecastDay *entry = forecast_slot(ring, day);
+  entry->day = day;
+  entry->low_c = low_c;
+  entry->high_c = high_c;
+  entry->conditions = conditions;
+  entry->reserved = 0;
+}
+
+const ForecastDay *forecast_find(const ForecastRing *ring, int32_t day)
+{
+  const ForecastDay *entry = forecast_slot((ForecastRing *)ring, day);
+  return ((day != 0) && (entry->day == day)) ? entry : NULL;
+}
+
+int32_t forecast_local_day(time_t time)
+{
+  struct tm *local = localtime(&time);
+  return calendar_days_from_civil(local->tm_year + 1900, local->tm_mon + 1, local->tm_mday);
+}
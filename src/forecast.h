@@ -0,0 +1,33 @@
+#pragma once
+
+#include "sdk.h"
+
+// Daily forecasts kept on the watch, one entry per local date. Entries
+// live in a ring indexed by the date, so storing a day replaces the one
+// FORECAST_DAYS days before it and looking one up is a single compare.
+// Today and tomorrow are picked by date, so the display rolls over at
+// midnight without asking the phone.
+
+#define FORECAST_DAYS 8
+
+typedef struct
+{
+  int32_t day;          // Days since the epoch, local date. 0 = empty.
+  int8_t low_c;
+  int8_t high_c;
+  uint8_t conditions;   // WEATHER_CONDITION_* code, see weather.h.
+  uint8_t reserved;
+} ForecastDay;
+
+typedef struct
+{
+  ForecastDay days[FORECAST_DAYS];
+} ForecastRing;
+
+void forecast_store(ForecastRing *ring, int32_t day, int low_c, int high_c, uint8_t conditions);
+
+// NULL if there is no forecast for that day.
+const ForecastDay *forecast_find(const ForecastRing *ring, int32_t day);
+
+// Local date of a time, in days since the epoch.
+int32_t forecast_local_day(time_t time);
@@ -0,0 +1,84 @@
+#include "format.h"
+
+// Fixed width rows rather than pointers, so the tables need no
+// relocations.
+static const char s_dayNames[7][10] = {
+  "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday",
+};
+
+static const char s_monthAbbreviations[12][4] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+};
+
+void format_begin(FormatBuffer *out, char *buffer, size_t size)
+{
+  out->next = buffer;
+  out->last = buffer + size - 1;
+  buffer[0] = 0;
+}
+
+void format_char(FormatBuffer *out, char c)
+{
+  if (out->next < out->last)
+  {
+    *out->next++ = c;
+    *out->next = 0;
+  }
+}
+
+void format_string(FormatBuffer *out, const char *string)
+{
+  while (*string)
+  {
+    format_char(out, *string++);
+  }
+}
+
+void format_prefix(FormatBuffer *out, const char *string, size_t count)
+{
+  while (count-- && *string)
+  {
+    format_char(out, *string++);
+  }
+}
+
+void format_int(FormatBuffer *out, int value)
+{
+  // Negated as unsigned, so INT_MIN comes out right too.
+  unsigned int magnitude = value;
+  if (value < 0)
+  {
+    format_char(out, '-');
+    magnitude = 0u - magnitude;
+  }
+
+  char digits[10];
+  int count = 0;
+  do
+  {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+
+  while (count)
+  {
+    format_char(out, digits[--count]);
+  }
+}
+
+void format_two_digits(FormatBuffer *out, int value, char pad)
+{
+  format_char(out, (value < 10) ? pad : '0' + value / 10);
+  format_char(out, '0' + value % 10);
+}
+
+const char *format_day_name(int dayOfWeek)
+{
+  return s_dayNames[dayOfWeek % 7];
+}
+
+const char *format_month_abbreviation(int month)
+{
+  return s_monthAbbreviations[month % 12];
+}
+
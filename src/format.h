@@ -0,0 +1,35 @@
+#pragma once
+
+#include <pebble.h>
+
+// Text for the display, written straight into fixed buffers. There are
+// no varargs, no locale and no floating point: each call appends one
+// piece. Text that doesn't fit is cut off, and the buffer always ends
+// in a 0.
+
+typedef struct
+{
+  char *next;           // Where the next character goes.
+  char *last;           // The last byte of the buffer, kept for the 0.
+} FormatBuffer;
+
+// size must be at least 1.
+void format_begin(FormatBuffer *out, char *buffer, size_t size);
+
+void format_char(FormatBuffer *out, char c);
+void format_string(FormatBuffer *out, const char *string);
+
+// At most count characters of string.
+void format_prefix(FormatBuffer *out, const char *string, size_t count);
+
+// Decimal, with a '-' when negative; as printf's %d.
+void format_int(FormatBuffer *out, int value);
+
+// 0 to 99 as two digits. Below 10 the first is pad: '0' as strftime's
+// %H and %M, ' ' as %e and %l.
+void format_two_digits(FormatBuffer *out, int value, char pad);
+
+// English names, as strftime's %A and %b in the C locale. dayOfWeek is
+// 0 for Sunday and month 0 for January, as in struct tm.
+const char *format_day_name(int dayOfWeek);
+const char *format_month_abbreviation(int month);
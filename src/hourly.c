@@ -0,0 +1,38 @@
+#include "hourly.h"
+
+#define SECONDS_PER_HOUR 3600
+
+static time_t hourly_end(const HourlyTimeline *timeline)
+{
+  return timeline->start + (HOURLY_HOURS - 1) * SECONDS_PER_HOUR;
+}
+
+bool hourly_covers(const HourlyTimeline *timeline, time_t time, int32_t seconds)
+{
+  return (timeline->start != 0) && (time >= timeline->start) && (time + seconds <= hourly_end(timeline));
+}
+
+bool hourly_temperature(const HourlyTimeline *timeline, time_t time, int *temperature_c)
+{
+  if (!hourly_covers(timeline, time, 0))
+  {
+    return false;
+  }
+
+  int32_t elapsed = time - timeline->start;
+  int hour = elapsed / SECONDS_PER_HOUR;
+  int32_t intoHour = elapsed % SECONDS_PER_HOUR;
+
+  int before = timeline->first_c;
+  for (int step = 0; step < hour; step++)
+  {
+    before += timeline->steps[step];
+  }
+  int after = (hour < HOURLY_HOURS - 1) ? before + timeline->steps[hour] : before;
+
+  // Round half away from zero, in whole numbers only.
+  int32_t scaled = before * SECONDS_PER_HOUR + (after - before) * intoHour;
+  *temperature_c = (scaled >= 0) ? (scaled + SECONDS_PER_HOUR / 2) / SECONDS_PER_HOUR
+                                 : -((-scaled + SECONDS_PER_HOUR / 2) / SECONDS_PER_HOUR);
+  return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "sdk.h"
+
+// Hourly temperature forecast for the next two days, delta encoded:
+// the temperature at the first hour, then the change from each hour to
+// the next as one signed byte. 52 bytes in all, so it fits in the weather
+// message and the persisted state. Between hours the temperature is
+// interpolated, so the watch can estimate the current temperature for
+// as long as the timeline lasts without hearing from the phone.
+
+#define HOURLY_HOURS 48
+#define HOURLY_SIZE (5 + HOURLY_HOURS - 1)
+
+typedef struct
+{
+  int32_t start;                    // Time of the first hour, seconds since the epoch. 0 = empty.
+  int8_t first_c;                   // Temperature at start, degrees C.
+  int8_t steps[HOURLY_HOURS - 1];   // Change from each hour to the next.
+} HourlyTimeline;
+
+// Temperature at a time, interpolated between the hours either side of
+// it and rounded to the nearest degree. Returns false if the timeline
+// does not cover that time.
+bool hourly_temperature(const HourlyTimeline *timeline, time_t time, int *temperature_c);
+
+// Whether the timeline covers everything from time to seconds after it.
+bool hourly_covers(const HourlyTimeline *timeline, time_t time, int32_t seconds);
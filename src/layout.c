@@ -0,0 +1,113 @@
+#include "layout.h"
+
+#define FRAME(x, y, w, h) { { (x), (y) }, { (w), (h) } }
+
+// A calendar week on one row: the x of each cell, left to right.
+#define WEEK(y, w, h, x0, x1, x2, x3, x4, x5, x6) \
+  FRAME(x0, y, w, h), FRAME(x1, y, w, h), FRAME(x2, y, w, h), FRAME(x3, y, w, h), \
+  FRAME(x4, y, w, h), FRAME(x5, y, w, h), FRAME(x6, y, w, h)
+
+#define HIDDEN_WEEK WEEK(0, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+
+#if defined(PBL_ROUND)
+
+// 180x180 round. Everything is pulled in from the corners, and there is
+// only room for this week.
+static const Layout s_layout = {
+  .fields = {
+    [FIELD_BATTERY] = FRAME(34, 12, 36, 16),
+    [FIELD_LINK_STATUS] = FRAME(70, 12, 44, 16),
+    [FIELD_POWER_PROFILE] = FRAME(114, 12, 32, 16),
+    [FIELD_TIME] = FRAME(18, 24, 118, 50),
+    [FIELD_TIME_AM_PM] = FRAME(138, 30, 24, 18),
+    [FIELD_TIME_SECONDS] = FRAME(138, 47, 24, 18),
+    [FIELD_DATE] = FRAME(0, 62, 180, 28),
+    [FIELD_WEATHER_CURRENT] = FRAME(18, 87, 144, 20),
+    [FIELD_WEATHER_LABEL1] = FRAME(18, 104, 25, 20),
+    [FIELD_WEATHER_FORECAST1] = FRAME(41, 104, 121, 20),
+    [FIELD_WEATHER_LABEL2] = FRAME(18, 121, 25, 20),
+    [FIELD_WEATHER_FORECAST2] = FRAME(41, 121, 121, 20),
+  },
+  .time24h = FRAME(18, 24, 125, 50),
+  .timeArea = FRAME(18, 24, 144, 50),
+};
+
+static const CalendarLayout s_calendarLayouts[2] = {
+  // Sunday first: gaps after Sunday and before Saturday.
+  { { WEEK(142, 16, 20, 33, 51, 67, 83, 99, 115, 133), HIDDEN_WEEK } },
+  // Monday first: a gap before the weekend.
+  { { WEEK(142, 16, 20, 33, 49, 65, 81, 97, 115, 131), HIDDEN_WEEK } },
+};
+
+#elif defined(PBL_PLATFORM_EMERY)
+
+// 200x228. The same arrangement with wider fields and larger calendar
+// cells.
+static const Layout s_layout = {
+  .fields = {
+    [FIELD_BATTERY] = FRAME(0, 0, 70, 16),
+    [FIELD_LINK_STATUS] = FRAME(70, 0, 72, 16),
+    [FIELD_POWER_PROFILE] = FRAME(142, 0, 56, 16),
+    [FIELD_TIME] = FRAME(0, 14, 170, 50),
+    [FIELD_TIME_AM_PM] = FRAME(172, 20, 28, 18),
+    [FIELD_TIME_SECONDS] = FRAME(172, 37, 28, 18),
+    [FIELD_DATE] = FRAME(0, 56, 200, 28),
+    [FIELD_WEATHER_CURRENT] = FRAME(4, 88, 196, 22),
+    [FIELD_WEATHER_LABEL1] = FRAME(4, 112, 28, 22),
+    [FIELD_WEATHER_FORECAST1] = FRAME(32, 112, 168, 22),
+    [FIELD_WEATHER_LABEL2] = FRAME(4, 136, 28, 22),
+    [FIELD_WEATHER_FORECAST2] = FRAME(32, 136, 168, 22),
+  },
+  .time24h = FRAME(0, 14, 178, 50),
+  .timeArea = FRAME(0, 14, 200, 50),
+};
+
+static const CalendarLayout s_calendarLayouts[2] = {
+  { { WEEK(172, 26, 26, 1, 30, 58, 86, 114, 142, 173),
+      WEEK(200, 26, 26, 1, 30, 58, 86, 114, 142, 173) } },
+  { { WEEK(172, 26, 26, 1, 29, 57, 85, 113, 145, 173),
+      WEEK(200, 26, 26, 1, 29, 57, 85, 113, 145, 173) } },
+};
+
+#else
+
+// 144x168.
+static const Layout s_layout = {
+  .fields = {
+    [FIELD_BATTERY] = FRAME(0, 0, 50, 16),
+    [FIELD_LINK_STATUS] = FRAME(50, 0, 54, 16),
+    [FIELD_POWER_PROFILE] = FRAME(104, 0, 38, 16),
+    [FIELD_TIME] = FRAME(0, 10, 118, 50),
+    [FIELD_TIME_AM_PM] = FRAME(120, 16, 24, 18),
+    [FIELD_TIME_SECONDS] = FRAME(120, 33, 24, 18),
+    [FIELD_DATE] = FRAME(0, 48, 144, 28),
+    [FIELD_WEATHER_CURRENT] = FRAME(2, 73, 142, 20),
+    [FIELD_WEATHER_LABEL1] = FRAME(2, 90, 25, 20),
+    [FIELD_WEATHER_FORECAST1] = FRAME(25, 90, 119, 20),
+    [FIELD_WEATHER_LABEL2] = FRAME(2, 107, 25, 20),
+    [FIELD_WEATHER_FORECAST2] = FRAME(25, 107, 119, 20),
+  },
+  .time24h = FRAME(0, 10, 125, 50),
+  .timeArea = FRAME(0, 10, 144, 50),
+};
+
+static const CalendarLayout s_calendarLayouts[2] = {
+  // Sunday first: gaps between Sunday/Monday and Friday/Saturday.
+  { { WEEK(132, 20, 20, 0, 22, 42, 62, 82, 102, 124),
+      WEEK(150, 20, 20, 0, 22, 42, 62, 82, 102, 124) } },
+  // Monday first: a gap between Friday/Saturday.
+  { { WEEK(132, 20, 20, 0, 20, 40, 60, 80, 104, 124),
+      WEEK(150, 20, 20, 0, 20, 40, 60, 80, 104, 124) } },
+};
+
+#endif
+
+const Layout *layout_fields(void)
+{
+  return &s_layout;
+}
+
+const CalendarLayout *layout_calendar(bool mondayFirst)
+{
+  return &s_calendarLayouts[mondayFirst ? 1 : 0];
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <pebble.h>
+#include "calendar.h"
+
+// Where every text field goes, fixed at compile time. Each screen size
+// has one table for the fields and one per week-start mode for the
+// calendar, which differ only in where the weekend gaps fall. Changing
+// the week start moves the existing calendar layers; nothing is
+// allocated or freed.
+//
+// Screens: 144x168 (Aplite, Basalt and Diorite), 180x180 round (Chalk)
+// and 200x228 (Emery). The round screen has room for one calendar
+// week; the second week's frames are empty there.
+
+// Text fields shown on the watch face.
+#define FIELD_BATTERY 0
+#define FIELD_LINK_STATUS 1
+#define FIELD_TIME 2
+#define FIELD_TIME_AM_PM 3
+#define FIELD_TIME_SECONDS 4
+#define FIELD_DATE 5
+#define FIELD_WEATHER_CURRENT 6
+#define FIELD_WEATHER_LABEL1 7
+#define FIELD_WEATHER_FORECAST1 8
+#define FIELD_WEATHER_LABEL2 9
+#define FIELD_WEATHER_FORECAST2 10
+#define FIELD_POWER_PROFILE 11
+#define FIELD_CALENDAR_DAY 12 // 14 fields, one for each calendar day.
+#define FIELD_COUNT 26
+
+typedef struct
+{
+  GRect fields[FIELD_CALENDAR_DAY]; // Every field but the calendar. FIELD_TIME
+                                    // leaves room for AM/PM,
+  GRect time24h;                    // which a 24 hour clock doesn't show.
+  GRect timeArea;                   // Covers the time fields, for the canvas build.
+} Layout;
+
+typedef struct
+{
+  GRect days[CALENDAR_DAYS];
+} CalendarLayout;
+
+const Layout *layout_fields(void);
+const CalendarLayout *layout_calendar(bool mondayFirst);
@@ -1,32 +1,34 @@
 #include <pebble.h>
+#include "calendar.h"
+#include "config.h"
+#include "counters.h"
+#include "display.h"
+#include "forecast.h"
+#include "format.h"
+#include "hourly.h"
+#include "layout.h"
+#include "memory.h"
+#include "power.h"
+#include "send_queue.h"
+#include "snapshot.h"
+#include "state.h"
+#include "units.h"
+#include "weather.h"
 
 // Keys to link Javascript code to C code.
-#define KEY_TEMPERATURE 0
-#define KEY_CONDITIONS 1
-#define KEY_TEMP_MIN 2
-#define KEY_TEMP_MAX 3
-#define KEY_WIND_SPEED 4
-#define KEY_WIND_DIRECTION 5
-#define KEY_HUMIDITY 6
-#define KEY_DESCRIPTION 7
-#define KEY_DAY1_CONDITIONS 8
-#define KEY_DAY1_TEMP_MIN 9
-#define KEY_DAY1_TEMP_MAX 10
-#define KEY_DAY1_TIME 11
-#define KEY_DAY2_CONDITIONS 12
-#define KEY_DAY2_TEMP_MIN 13
-#define KEY_DAY2_TEMP_MAX 14
-#define KEY_DAY2_TIME 15
-#define KEY_DAY3_CONDITIONS 16
-#define KEY_DAY3_TEMP_MIN 17
-#define KEY_DAY3_TEMP_MAX 18
-#define KEY_DAY3_TIME 19
-
-// Keys for configuration.
-#define CONFIG_KEY_TEMPERATURE_UNITS 50
-#define CONFIG_KEY_WINDSPEED_UNITS 51
-#define CONFIG_KEY_WEEKNUMBER_ENABLED 52
-#define CONFIG_KEY_MONDAY_FIRST 53
+#define KEY_REQUEST_WEATHER 0 // 1 when the watch has no weather to show yet.
+#define KEY_WEATHER 20 // One WEATHER_MESSAGE_SIZE byte array, see weather.h.
+#define KEY_REQUEST_COUNTERS 21
+#define KEY_COUNTERS 22 // One COUNTERS_MESSAGE_SIZE byte array, see counters.h.
+
+// What each outgoing message is for, and how much it matters. Used by
+// send_queue to merge and order messages.
+#define MESSAGE_WEATHER_REQUEST 0
+#define PRIORITY_WEATHER_REQUEST 1
+#define MESSAGE_COUNTERS 1
+#define PRIORITY_COUNTERS 0
+
+// Keys for configuration are in config.h.
 
 // Keys to reference persistent storage.
 #define STORAGE_KEY_CURRENT_TEMPERATURE_C 100
@@ -44,175 +46,360 @@
 #define STORAGE_KEY_WINDSPEED_UNITS 112
 #define STORAGE_KEY_WEEKNUMBER_ENABLED 113
 #define STORAGE_KEY_MONDAY_FIRST 114
-
-// Durations for updates and time outs. Set as desired.
-#define NUMBER_OF_SECONDS_BETWEEN_WEATHER_UPDATES 1800
+#define STORAGE_KEY_COUNTERS 121
+// STORAGE_KEY_STATE 120 and STORAGE_KEY_SNAPSHOT 122 are in state.h.
+#define STORAGE_KEY_DISPLAY 123
+#define STORAGE_KEY_WORKER_LAUNCH 124 // AppWorkerResult of the one launch.
+
+// Durations for updates and time outs. Set as desired. How often the
+// weather is updated and how long a tap shows seconds depend on the
+// battery, see power.c.
 #define NUMBER_OF_SECONDS_UNTIL_DATA_CONSIDERED_LOST 60
-#define NUMBER_OF_SECONDS_TO_SHOW_SECONDS_AFTER_TAP 180
-
-// Constants for Settings
-#define TEMPERATURE_UNITS_F 0
-#define TEMPERATURE_UNITS_C 1
-#define WINDSPEED_UNITS_KNOTS 0
-#define WINDSPEED_UNITS_MPH 1
-#define WINDSPEED_UNITS_KPH 2
+
+// Failed weather requests are retried after 30 seconds, doubling on
+// every failure in a row up to 2 hours.
+#define NUMBER_OF_SECONDS_FIRST_WEATHER_RETRY 30
+#define NUMBER_OF_SECONDS_MAX_WEATHER_RETRY 7200
+
+// Constants for Settings; the units are in units.h.
 #define FALSE 0
 #define TRUE 1
-  
-// Persistent storage variables (must be global).
-static int currentTemperature_c;
-static char currentConditions[32];
-static char currentDayForecastConditions[32];
-static int currentLowTemperature_c;
-static int currentHighTemperature_c;
-static int currentWindDirection_deg;
-static int currentWindSpeed_metersPerSecond;
-static int currentDate;
-static int forecastLowTemperature_c;
-static int forecastHighTemperature_c;
-static char forecastConditions[32];
-static int temperatureUnits; // 0 = F, 1 = C
-static int windSpeedUnits; // 0 = KNOTS, 1 = MPH, 2 = KPH
-static int weekNumberEnabled; // 0 = FALSE, 1 = TRUE
-static int mondayFirst; // 0 = FALSE, 1 = TRUE
+
+// Rendering. Drawing every field from one canvas layer instead of one
+// TextLayer per field saves the heap used by 25 TextLayers, which matters
+// on low-RAM platforms.
+#ifndef USE_CANVAS_LAYER
+#define USE_CANVAS_LAYER 0
+#endif
+
+static PersistedState s_state;
+static PersistedState s_savedState; // What flash holds, so unchanged state is never rewritten.
+// The weather for this hour, as the worker or the face prepared it.
+static WeatherSnapshot s_snapshot;
+// What the face showed when it last closed, as flash holds it. Fields
+// restored from it point into its text until they next change.
+static DisplaySnapshot s_display;
+// The current weather as shown, in the chosen units. Converted when
+// the weather or the units change, not every time the line is built.
+static int s_shownTemperature;
+static int s_shownWindSpeed;
+static const char *s_shownWindDirection = "";
 
 // Status variables.
 bool isShowingSeconds = false;
 bool connectedToBluetooth = false;
 bool connectedToData = false;
-time_t timeOfLastDataResponse = 0;
 time_t timeOfLastDataRequest = 0;
+time_t timeOfLastWeather = 0;
 time_t timeOfLastTap = 0;
+time_t timeSecondsShownSince = 0;
 int lastCalendarDateUpdatedTo = -1;
 
 // Watch layers.
+typedef struct
+{
+  GRect frame;
+  GFont font;
+  GTextAlignment alignment;
+  GColor textColor;
+  GColor backgroundColor;
+  const char *text;
+#if USE_CANVAS_LAYER
+  Layer *canvas;
+#else
+  TextLayer *layer;
+#endif
+} TextField;
+
+// Weather requests. Only one is ever in flight; s_requestTimer is the
+// response timeout while in flight and the retry while failed.
+typedef enum
+{
+  REQUEST_IDLE,
+  REQUEST_IN_FLIGHT,
+  REQUEST_SUCCEEDED,
+  REQUEST_FAILED,
+} RequestState;
+
+static RequestState s_requestState = REQUEST_IDLE;
+static AppTimer *s_requestTimer;
+static int s_requestFailures; // Failures in a row.
+static bool s_launchPending; // Set until a launch drawn from s_display is finished,
+static Layer *s_launchLayer;  // ...which this layer starts once the first frame is drawn,
+static AppTimer *s_launchTimer; // ...from this timer.
+
 static Window *s_main_window;
-static TextLayer *s_battery_layer;
-static TextLayer *s_linkStatus_layer;
-static TextLayer *s_time_layer;
-static TextLayer *s_time_am_pm_layer;
-static TextLayer *s_time_seconds_layer;
-static TextLayer *s_date_layer;
-static TextLayer *s_weather_current_layer;
-static TextLayer *s_weather_label1_layer;
-static TextLayer *s_weather_forecast1_layer;
-static TextLayer *s_weather_label2_layer;
-static TextLayer *s_weather_forecast2_layer;
-static TextLayer *s_calendarDay_layer[14];
-
-static int getFahrenheitFromCelsius(int temp_celsius)
-{
-  // Use only whole numbers in math operations. The Pebble watch
-  // hardware does not support floats, and floating operations
-  // are expensive to emulate (processing and memory).
-  return ((temp_celsius * 9 / 5) + 32);
+static TextField s_fields[FIELD_COUNT];
+static GFont s_calendarFont;
+static GFont s_calendarTodayFont;
+static CalendarGrid s_calendar;
+static bool s_clock24h;
+static char s_timeSecondsBuffer[3];
+static AppTimer *s_secondsTimer; // Ends showing seconds after a tap.
+static PowerProfileId s_powerProfile;
+static bool s_tapsSubscribed;
+#if USE_CANVAS_LAYER
+static Layer *s_canvas_layer;
+static Layer *s_time_canvas_layer;
+static Layer *s_seconds_canvas_layer;
+#endif
+
+// The temperature in the chosen units, then the unit's letter if
+// withUnit is set.
+static void appendTemperature(FormatBuffer *text, int temperature, bool withUnit)
+{
+  format_int(text, temperature);
+  if (withUnit)
+  {
+    format_char(text, units_temperature_letter(s_state.temperatureUnits));
+  }
 }
 
-static int getPreferedWindSpeed(int windSpeed_metersPerSecond)
+static void create_field(int field, GRect frame, GFont font, GTextAlignment alignment,
+                         GColor textColor, GColor backgroundColor, const char *text)
 {
-  // Use only whole numbers in math operations. The Pebble watch
-  // hardware does not support floats, and floating operations
-  // are expensive to emulate (processing and memory).
-  switch(windSpeedUnits)
+  TextField *textField = &s_fields[field];
+  textField->frame = frame;
+  textField->font = font;
+  textField->alignment = alignment;
+  textField->textColor = textColor;
+  textField->backgroundColor = backgroundColor;
+  textField->text = text;
+#if USE_CANVAS_LAYER
+  // The time fields have a small layer of their own, and the seconds a
+  // smaller one still, so a tick only marks that part of the screen
+  // dirty.
+  if (field == FIELD_TIME_SECONDS)
   {
-    case WINDSPEED_UNITS_KNOTS:
-      return (windSpeed_metersPerSecond * 194384 / 100000); // * 1.94384
-    case WINDSPEED_UNITS_MPH:
-      return (windSpeed_metersPerSecond * 223694 / 100000); // * 2.23694
-    case WINDSPEED_UNITS_KPH:
-      return (windSpeed_metersPerSecond * 36 / 10); // * 3.6
+    textField->canvas = s_seconds_canvas_layer;
   }
-  
-  // Invalid windspeed units.
-  return windSpeed_metersPerSecond;
+  else if ((field == FIELD_TIME) || (field == FIELD_TIME_AM_PM))
+  {
+    textField->canvas = s_time_canvas_layer;
+  }
+  else
+  {
+    textField->canvas = s_canvas_layer;
+  }
+  layer_mark_dirty(textField->canvas);
+#else
+  textField->layer = text_layer_create(frame);
+  text_layer_set_background_color(textField->layer, backgroundColor);
+  text_layer_set_text_color(textField->layer, textColor);
+  text_layer_set_font(textField->layer, font);
+  text_layer_set_text_alignment(textField->layer, alignment);
+  if (text)
+  {
+    text_layer_set_text(textField->layer, text);
+  }
+  layer_add_child(window_get_root_layer(s_main_window), text_layer_get_layer(textField->layer));
+#endif
 }
 
+static void destroy_field(int field)
+{
+#if !USE_CANVAS_LAYER
+  text_layer_destroy(s_fields[field].layer);
+  s_fields[field].layer = NULL;
+#endif
+  s_fields[field].text = NULL;
+}
+
+// Show text that stays where it is for as long as the field shows it.
+static void show_field_text(int field, const char *text)
+{
+  TextField *textField = &s_fields[field];
+  counters_add(COUNTER_TEXT_UPDATES, 1);
+  textField->text = text;
+#if USE_CANVAS_LAYER
+  layer_mark_dirty(textField->canvas);
+#else
+  text_layer_set_text(textField->layer, text);
+#endif
+}
+
+// Setting a layer's text or font marks it dirty and forces a redraw of
+// the frame, even when nothing changed. Keep a shadow copy of what each
+// field shows and only touch the layer when the content is different.
+static void set_field_text(int field, char *shownBuffer, size_t bufferSize, const char *text)
+{
+  TextField *textField = &s_fields[field];
+  if (textField->text && (strncmp(textField->text, text, bufferSize) == 0))
+  {
+    return;
+  }
+  FormatBuffer shown;
+  format_begin(&shown, shownBuffer, bufferSize);
+  format_string(&shown, text);
+  show_field_text(field, shownBuffer);
+}
+
+static void set_field_font(int field, GFont font)
+{
+  TextField *textField = &s_fields[field];
+  if (textField->font == font)
+  {
+    return;
+  }
+  textField->font = font;
+#if USE_CANVAS_LAYER
+  layer_mark_dirty(textField->canvas);
+#else
+  text_layer_set_font(textField->layer, font);
+#endif
+}
+
+static void set_field_frame(int field, GRect frame)
+{
+  TextField *textField = &s_fields[field];
+  if (grect_equal(&textField->frame, &frame))
+  {
+    return;
+  }
+  textField->frame = frame;
+#if USE_CANVAS_LAYER
+  layer_mark_dirty(textField->canvas);
+#else
+  layer_set_frame(text_layer_get_layer(textField->layer), frame);
+#endif
+}
+
+#if USE_CANVAS_LAYER
+static void canvas_update_proc(Layer *layer, GContext *ctx)
+{
+  // Field frames are in window coordinates.
+  GPoint offset = layer_get_frame(layer).origin;
+
+  for (int field = 0; field < FIELD_COUNT; field++)
+  {
+    TextField *textField = &s_fields[field];
+    if (textField->canvas != layer)
+    {
+      continue;
+    }
+
+    GRect frame = textField->frame;
+    frame.origin.x -= offset.x;
+    frame.origin.y -= offset.y;
+    if (!gcolor_equal(textField->backgroundColor, GColorClear))
+    {
+      graphics_context_set_fill_color(ctx, textField->backgroundColor);
+      graphics_fill_rect(ctx, frame, 0, GCornerNone);
+    }
+    if (textField->text && textField->text[0])
+    {
+      graphics_context_set_text_color(ctx, textField->textColor);
+      graphics_draw_text(ctx, textField->text, textField->font, frame,
+                         GTextOverflowModeWordWrap, textField->alignment, NULL);
+    }
+  }
+}
+#endif
+
 static void update_link_label()
 {
   static char bluetoothBuffer[8];
+  const char *linkStatus;
   
   if (connectedToBluetooth)
   {
     if (connectedToData)
     {
       // Connection is good!
-      bluetoothBuffer[0] = 0;
+      linkStatus = "";
     }
     else
     {
       // Bluetooth Connection, but failed to get Data.
-      strncpy(bluetoothBuffer, "No Data", 7);
+      linkStatus = "No Data";
     }
   }
   else
   {
     // No Bluetooth Connection
-    strncpy(bluetoothBuffer, "No Link", 7);
+    linkStatus = "No Link";
   }
-  text_layer_set_text(s_linkStatus_layer, bluetoothBuffer);
+  set_field_text(FIELD_LINK_STATUS, bluetoothBuffer, sizeof(bluetoothBuffer), linkStatus);
 }
 
-static void update_time(struct tm *tick_time)
+// The small field next to the time. It shows the week number when that
+// is enabled, seconds for a while after a tap, or nothing. A 24 hour
+// time runs across it, so then it is always blank.
+static void update_seconds(struct tm *tick_time)
 {
-  static char timeBuffer[6]; // = "24:00";
-  static char timeAmPmBuffer[3]; // = "am";
-  static char timeSecondsBuffer[3];
-
-  // Update the Time
-  if (clock_is_24h_style())
-  {
-    strftime(timeBuffer, sizeof("00:00"), "%H:%M", tick_time);
-    text_layer_set_text(s_time_layer, timeBuffer);
-
-    // If using 24 hours, then don't draw AM/PM and seconds.
-    // (At 2400 time, it will run across the AM/PM and seconds).
-    timeSecondsBuffer[0] = 0;
-    text_layer_set_text(s_time_seconds_layer, timeSecondsBuffer);
-    timeAmPmBuffer[0] = 0;
-    text_layer_set_text(s_time_am_pm_layer, timeAmPmBuffer);
-  }
-  else
+  int value = -1;
+  if (!s_clock24h)
   {
-    strftime(timeBuffer, sizeof("00:00"), "%l:%M", tick_time);
-    text_layer_set_text(s_time_layer, timeBuffer);
-  
-    // Update the seconds field.
-    if (weekNumberEnabled == TRUE)
+    if (s_state.weekNumberEnabled == TRUE)
     {
-      // Show Week Number in place of the seconds field.
-      if (mondayFirst == TRUE)
-      {
-        strftime(timeSecondsBuffer, sizeof("00"), "%W", tick_time);
-        text_layer_set_text(s_time_seconds_layer, timeSecondsBuffer);
-      }
-      else
-      {
-        strftime(timeSecondsBuffer, sizeof("00"), "%U", tick_time);
-        text_layer_set_text(s_time_seconds_layer, timeSecondsBuffer);
-      }
+      // Worked out with the calendar, once a day.
+      value = s_calendar.weekNumber;
     }
     else if (isShowingSeconds)
     {
       // isShowingSeconds is toggled by a watch bump to save battery.
-      strftime(timeSecondsBuffer, sizeof("00"), "%S", tick_time);
-      text_layer_set_text(s_time_seconds_layer, timeSecondsBuffer);
+      value = tick_time->tm_sec;
     }
-    else
+  }
+
+  char newSeconds[sizeof(s_timeSecondsBuffer)];
+  FormatBuffer text;
+  format_begin(&text, newSeconds, sizeof(newSeconds));
+  if (value >= 0)
+  {
+    format_two_digits(&text, value, '0');
+  }
+  set_field_text(FIELD_TIME_SECONDS, s_timeSecondsBuffer, sizeof(s_timeSecondsBuffer), newSeconds);
+}
+
+// Only the parts named in units_changed are worked out again: the
+// clock style, hours and minutes once a minute, AM/PM once an hour or
+// when the style changes. The seconds field is left to update_seconds.
+static void update_time(struct tm *tick_time, TimeUnits units_changed)
+{
+  static char timeBuffer[6]; // = "24:00";
+  static char timeAmPmBuffer[3]; // = "am";
+
+  // The user may switch between a 12 and 24 hour clock at any time.
+  if (units_changed & MINUTE_UNIT)
+  {
+    bool clock24h = clock_is_24h_style();
+    if (clock24h != s_clock24h)
     {
-      // Clear out the seconds field.
-      timeSecondsBuffer[0] = 0;
-      text_layer_set_text(s_time_seconds_layer, timeSecondsBuffer);
+      s_clock24h = clock24h;
+      const Layout *layout = layout_fields();
+      set_field_frame(FIELD_TIME, clock24h ? layout->time24h : layout->fields[FIELD_TIME]);
+      units_changed |= HOUR_UNIT;
     }
-    
-    if (tick_time->tm_hour < 12)
+  }
+
+  if (units_changed & HOUR_UNIT)
+  {
+    // If using 24 hours, then don't draw AM/PM and seconds.
+    // (At 2400 time, it will run across the AM/PM and seconds).
+    const char *newAmPm = "";
+    if (!s_clock24h)
     {
-      strncpy(timeAmPmBuffer, "AM", 2);
+      newAmPm = (tick_time->tm_hour < 12) ? "AM" : "PM";
     }
-    else
+    set_field_text(FIELD_TIME_AM_PM, timeAmPmBuffer, sizeof(timeAmPmBuffer), newAmPm);
+  }
+
+  if (units_changed & MINUTE_UNIT)
+  {
+    // "%H:%M", or "%l:%M" with a space padded 12 hour clock.
+    char newTime[sizeof(timeBuffer)];
+    FormatBuffer text;
+    format_begin(&text, newTime, sizeof(newTime));
+    int hour = tick_time->tm_hour;
+    if (!s_clock24h)
     {
-      strncpy(timeAmPmBuffer, "PM", 2);
+      hour = (hour % 12) ? hour % 12 : 12;
     }
-    text_layer_set_text(s_time_am_pm_layer, timeAmPmBuffer);
+    format_two_digits(&text, hour, s_clock24h ? '0' : ' ');
+    format_char(&text, ':');
+    format_two_digits(&text, tick_time->tm_min, '0');
+    set_field_text(FIELD_TIME, timeBuffer, sizeof(timeBuffer), newTime);
   }
 }
 
@@ -220,580 +407,697 @@ static void update_date(struct tm *tick_time)
 {
   static char dateBuffer[20];
   static char calendarDayBuffer[14][3];
+  char newDate[sizeof(dateBuffer)];
+  char newCalendarDay[3];
 
   // Keep track of the last date we updated to so we only have to
   // update when it changes.
   lastCalendarDateUpdatedTo = tick_time->tm_mday;
   
-  // Update the Date
-  strftime(dateBuffer, sizeof(dateBuffer), "%A, %b %e", tick_time); 
-  text_layer_set_text(s_date_layer, dateBuffer);
-
-  // Update the Calendar
-  char dayOfWeekString[2];
-  strftime(dayOfWeekString, sizeof(dayOfWeekString), "%w", tick_time);
-  int dayOfWeek = atoi(dayOfWeekString);
-  if (mondayFirst == TRUE)
-  {
-    // %w reports Sunday first, subtract by 1 to have Monday first.
-    dayOfWeek = dayOfWeek - 1;
-  }
-  
-  // Subtract back to Sunday of this week.
-  time_t calendarDate = time(NULL) - (86400 * dayOfWeek);
-
-  if ((mondayFirst == TRUE) && (dayOfWeek == -1))
-  {
-    // If configured for Monday first and we're on Sunday, then
-    // we need to wrap around to the end of the week for it to be
-    // displayed properly.
-    calendarDate -= (86400 * 7);
-    dayOfWeek = 6;
-  }
-
-  struct tm *calendarDate_time = localtime(&calendarDate);
+  // Update the Date, as strftime's "%A, %b %e".
+  FormatBuffer text;
+  format_begin(&text, newDate, sizeof(newDate));
+  format_string(&text, format_day_name(tick_time->tm_wday));
+  format_string(&text, ", ");
+  format_string(&text, format_month_abbreviation(tick_time->tm_mon));
+  format_char(&text, ' ');
+  format_two_digits(&text, tick_time->tm_mday, ' ');
+  set_field_text(FIELD_DATE, dateBuffer, sizeof(dateBuffer), newDate);
+
+  // Update the Calendar. Day numbers come from integer date arithmetic
+  // on the local date, so there are no localtime calls and a daylight
+  // saving change can't skip or repeat a day. At midnight the grid only
+  // moves the highlighted day, or shifts by a week.
+  calendar_update(&s_calendar,
+                  calendar_days_from_civil(tick_time->tm_year + 1900, tick_time->tm_mon + 1, tick_time->tm_mday),
+                  s_state.mondayFirst == TRUE);
 
   // Update labels for the next 2 weeks.
   for (int dayLoop = 0; dayLoop < 14; dayLoop++)
   {
     // If we're on our current day of the week, then bold it.
-    if (dayLoop == dayOfWeek)
+    if (dayLoop == s_calendar.todayIndex)
     {
-      text_layer_set_font(s_calendarDay_layer[dayLoop], fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
+      set_field_font(FIELD_CALENDAR_DAY + dayLoop, s_calendarTodayFont);
     }
     else
     {
-      text_layer_set_font(s_calendarDay_layer[dayLoop], fonts_get_system_font(FONT_KEY_GOTHIC_18));
+      set_field_font(FIELD_CALENDAR_DAY + dayLoop, s_calendarFont);
     }
-    strftime(calendarDayBuffer[dayLoop], 3, "%e", calendarDate_time);
-    text_layer_set_text(s_calendarDay_layer[dayLoop], calendarDayBuffer[dayLoop]);
 
-    calendarDate += 86400;
-    calendarDate_time = localtime(&calendarDate);
+    // Same as strftime's %e: space padded day of the month.
+    format_begin(&text, newCalendarDay, sizeof(newCalendarDay));
+    format_two_digits(&text, s_calendar.dayOfMonth[dayLoop], ' ');
+    set_field_text(FIELD_CALENDAR_DAY + dayLoop, calendarDayBuffer[dayLoop], sizeof(calendarDayBuffer[dayLoop]), newCalendarDay);
   }
+  memory_sample(MEMORY_CALENDAR);
 }
 
-static void update_weather()
+// One forecast line: the day's name cut to two letters, then its low,
+// high and summary. Both are blank while the phone has sent nothing for
+// that day.
+static void update_forecast_line(int labelField, char *labelBuffer, size_t labelSize,
+                                 int forecastField, char *forecastBuffer, size_t forecastSize,
+                                 const struct tm *date, const ForecastDay *forecast)
 {
-  static char current_weather_layer_buffer[64];
-  static char day1_label_layer_buffer[8];
-  static char day1_layer_buffer[64];
-  static char day2_label_layer_buffer[8];
-  static char day2_layer_buffer[64];
-
-  // Update Current Weather Condition
-  char currentTemperatureString[10];
-  switch(temperatureUnits)
-  {
-    case TEMPERATURE_UNITS_F:
-      snprintf(currentTemperatureString, sizeof(currentTemperatureString), "%dF",
-          getFahrenheitFromCelsius(currentTemperature_c));     
-      break;
-    case TEMPERATURE_UNITS_C:
-      snprintf(currentTemperatureString, sizeof(currentTemperatureString), "%dC",
-          currentTemperature_c);     
-      break;
-  }
-  char windDirectionString[3];
-  if (currentWindDirection_deg >= 337.5 || currentWindDirection_deg <= 22.5)
-  {
-    strcpy(windDirectionString, "N");    
-  }
-  else if (currentWindDirection_deg < 67.5) // currentWindDirection_deg > 22.5 &&
-  {
-    strcpy(windDirectionString, "NE");    
-  }
-  else if (currentWindDirection_deg <= 112.5) // currentWindDirection_deg >= 67.5 &&
-  {
-    strcpy(windDirectionString, "E");
-  }
-  else if (currentWindDirection_deg < 157.5) // currentWindDirection_deg > 112.5 &&
-  {
-    strcpy(windDirectionString, "SE");
-  }
-  else if (currentWindDirection_deg <= 202.5) // currentWindDirection_deg >= 157.5 &&
+  char newText[64];
+  FormatBuffer text;
+  format_begin(&text, newText, labelSize);
+  if (forecast)
   {
-    strcpy(windDirectionString, "S");
+    // A 2 character day abbreviation. Just as clear and saves space.
+    format_prefix(&text, format_day_name(date->tm_wday), 2);
   }
-  else if (currentWindDirection_deg < 247.5) // currentWindDirection_deg > 202.5 &&
-  {
-    strcpy(windDirectionString, "SW");
-  }
-  else if (currentWindDirection_deg <= 292.5) // currentWindDirection_deg >= 247.5 &&
+  set_field_text(labelField, labelBuffer, labelSize, newText);
+
+  format_begin(&text, newText, sizeof(newText));
+  if (forecast)
   {
-    strcpy(windDirectionString, "W");
+    appendTemperature(&text, units_temperature(forecast->low_c, s_state.temperatureUnits), false);
+    format_char(&text, '/');
+    appendTemperature(&text, units_temperature(forecast->high_c, s_state.temperatureUnits), true);
+    format_char(&text, ' ');
+    format_string(&text, weather_summary(forecast->conditions));
   }
-  else if (currentWindDirection_deg < 337.5) // currentWindDirection_deg > 292.5 &&
+  set_field_text(forecastField, forecastBuffer, forecastSize, newText);
+}
+
+static void prepare_snapshot()
+{
+  snapshot_prepare(&s_snapshot, &s_state, time(NULL), power_profile(s_powerProfile));
+}
+
+// The snapshot the worker saved, if it was prepared from the state
+// loaded, today, and the weather isn't due yet.
+static bool read_snapshot()
+{
+  WeatherSnapshot snapshot;
+  time_t now = time(NULL);
+  if ((persist_get_size(STORAGE_KEY_SNAPSHOT) != sizeof(snapshot)) ||
+      (persist_read_data(STORAGE_KEY_SNAPSHOT, &snapshot, sizeof(snapshot)) != sizeof(snapshot)) ||
+      !snapshot_current(&snapshot, &s_state, now))
   {
-    strcpy(windDirectionString, "NW");
+    return false;
   }
-  snprintf(current_weather_layer_buffer, sizeof(current_weather_layer_buffer), "%s %d%s %s", 
-          currentTemperatureString, 
-          getPreferedWindSpeed(currentWindSpeed_metersPerSecond), 
-          windDirectionString,
-          currentConditions);
-  text_layer_set_text(s_weather_current_layer, current_weather_layer_buffer);
+  s_snapshot = snapshot;
+  s_snapshot.temperature_c = snapshot_temperature(&s_state, now);
+  return true;
+}
 
-  // Update Labels for which Forecast Day
-  if (currentDate > 0)
-  {
-    time_t currentDate_t = currentDate;
-    struct tm *currentCalendarTime = localtime(&currentDate_t);
-    strftime(day1_label_layer_buffer, sizeof(day1_label_layer_buffer), "%a", currentCalendarTime);
-    // Cut off the 3rd letter to show a 2 character day abbreviation. Just as clear and saves space.
-    day1_label_layer_buffer[2] = 0;
-    text_layer_set_text(s_weather_label1_layer, day1_label_layer_buffer);
+static void convert_current_weather()
+{
+  s_shownTemperature = units_temperature(s_snapshot.temperature_c, s_state.temperatureUnits);
+  s_shownWindSpeed = units_wind_speed(s_state.currentWindSpeed_metersPerSecond, s_state.windSpeedUnits);
+  s_shownWindDirection = units_compass8(s_state.currentWindDirection_deg);
+}
 
-    time_t forecastDate_t = currentDate_t + 86400;
-    struct tm *forecastCalendarTime = localtime(&forecastDate_t);
-    strftime(day2_label_layer_buffer, sizeof(day2_label_layer_buffer), "%a", forecastCalendarTime);
-    // Cut off the 3rd letter to show a 2 character day abbreviation. Just as clear and saves space.
-    day2_label_layer_buffer[2] = 0;
-    text_layer_set_text(s_weather_label2_layer, day2_label_layer_buffer);
-  }
+static void update_current_weather()
+{
+  static char current_weather_layer_buffer[64];
+  char newText[64];
+
+  // Update Current Weather Condition: temperature, wind speed and
+  // direction, description.
+  FormatBuffer text;
+  format_begin(&text, newText, sizeof(newText));
+  appendTemperature(&text, s_shownTemperature, true);
+  format_char(&text, ' ');
+  format_int(&text, s_shownWindSpeed);
+  format_string(&text, s_shownWindDirection);
+  format_char(&text, ' ');
+  format_string(&text, weather_description(s_state.currentConditions));
+  set_field_text(FIELD_WEATHER_CURRENT, current_weather_layer_buffer, sizeof(current_weather_layer_buffer), newText);
+}
 
-  // Update Today's Weather Condition
-  switch(temperatureUnits)
-  {
-    case TEMPERATURE_UNITS_F:
-      snprintf(day1_layer_buffer, sizeof(day1_layer_buffer), "%d/%dF %s", 
-              getFahrenheitFromCelsius(currentLowTemperature_c), getFahrenheitFromCelsius(currentHighTemperature_c),
-              currentDayForecastConditions);
-      break;
-    case TEMPERATURE_UNITS_C:
-      snprintf(day1_layer_buffer, sizeof(day1_layer_buffer), "%d/%dC %s", 
-              currentLowTemperature_c, currentHighTemperature_c,
-              currentDayForecastConditions);
-      break;
-  }
-  text_layer_set_text(s_weather_forecast1_layer, day1_layer_buffer);
+static void update_forecast()
+{
+  static char day1_label_layer_buffer[8];
+  static char day1_layer_buffer[64];
+  static char day2_label_layer_buffer[8];
+  static char day2_layer_buffer[64];
 
-  // Update Tomorrow's Weather Condition
-  switch(temperatureUnits)
-  {
-    case TEMPERATURE_UNITS_F:
-      snprintf(day2_layer_buffer, sizeof(day2_layer_buffer), "%d/%dF %s", 
-               getFahrenheitFromCelsius(forecastLowTemperature_c), getFahrenheitFromCelsius(forecastHighTemperature_c),
-               forecastConditions);
-      break;
-    case TEMPERATURE_UNITS_C:
-      snprintf(day2_layer_buffer, sizeof(day2_layer_buffer), "%d/%dC %s", 
-               forecastLowTemperature_c, forecastHighTemperature_c,
-               forecastConditions);
-      break;
-  }
-  text_layer_set_text(s_weather_forecast2_layer, day2_layer_buffer);
+  // Today's and tomorrow's forecast, as picked from the ring by date
+  // when the snapshot was prepared. Only the day of the week is needed
+  // for the labels, so tomorrow's is today's moved on by one.
+  time_t currentTime = time(NULL);
+  struct tm date = *localtime(&currentTime);
+  update_forecast_line(FIELD_WEATHER_LABEL1, day1_label_layer_buffer, sizeof(day1_label_layer_buffer),
+                       FIELD_WEATHER_FORECAST1, day1_layer_buffer, sizeof(day1_layer_buffer),
+                       &date, s_snapshot.today.day ? &s_snapshot.today : NULL);
+  date.tm_wday = (date.tm_wday + 1) % 7;
+  update_forecast_line(FIELD_WEATHER_LABEL2, day2_label_layer_buffer, sizeof(day2_label_layer_buffer),
+                       FIELD_WEATHER_FORECAST2, day2_layer_buffer, sizeof(day2_layer_buffer),
+                       &date, s_snapshot.tomorrow.day ? &s_snapshot.tomorrow : NULL);
+}
+
+static void update_weather()
+{
+  update_current_weather();
+  update_forecast();
 }
 
+static void set_power_profile(PowerProfileId profile);
+
 static void update_battery_state(BatteryChargeState charge_state)
 {
   static char batteryBuffer[8];
-  uint8_t raw_percent = charge_state.charge_percent;
+  char newBattery[sizeof(batteryBuffer)];
+  FormatBuffer text;
+  format_begin(&text, newBattery, sizeof(newBattery));
  
-  snprintf(batteryBuffer, sizeof(batteryBuffer), " %i%%", (int)raw_percent);
+  format_char(&text, ' ');
+  format_int(&text, charge_state.charge_percent);
+  format_char(&text, '%');
   if (charge_state.is_charging)
   {
-    strcat(batteryBuffer, "+");
+    format_char(&text, '+');
   }
   //else if (charge_state.is_plugged)
   //{
-  //  strcat(batteryBuffer, "*");
+  //  format_char(&text, '*');
   //}
-  text_layer_set_text(s_battery_layer, batteryBuffer);
+  set_field_text(FIELD_BATTERY, batteryBuffer, sizeof(batteryBuffer), newBattery);
+
+  PowerProfileId profile = power_profile_select(s_powerProfile, charge_state);
+  if (profile != s_powerProfile)
+  {
+    set_power_profile(profile);
+  }
 }
 
-static void update_bluetooth_state(bool bluetoothConnected)
+static void send_weather_request();
+static void request_weather();
+
+static void cancel_request_timer()
 {
-  connectedToBluetooth = bluetoothConnected;
-  update_link_label();
+  if (s_requestTimer)
+  {
+    app_timer_cancel(s_requestTimer);
+    s_requestTimer = NULL;
+  }
 }
 
-static void request_weather()
+static void retry_timer_callback(void *data)
 {
-  timeOfLastDataRequest = time(NULL);
-  
-  // Begin dictionary
-  DictionaryIterator *iter;
-  app_message_outbox_begin(&iter);
-
-  // Add a key-value pair
-  dict_write_uint8(iter, 0, 0);
+  s_requestTimer = NULL;
+  send_weather_request();
+}
 
-  // Send the message!
-  app_message_outbox_send();
+static void launch_request_callback(void *data)
+{
+  s_requestTimer = NULL;
+  request_weather();
 }
 
-static void create_calendar_layers()
+static void request_failed()
 {
-  int calendarX = 0;
-  int calendarY = 132;
-  for (int dayLoop = 0; dayLoop < 14; dayLoop++)
+  cancel_request_timer();
+  s_requestState = REQUEST_FAILED;
+  s_requestFailures++;
+
+  // Back off while the phone stays unreachable, so a long disconnect
+  // costs a handful of wakeups rather than one every few minutes.
+  uint32_t retrySeconds = NUMBER_OF_SECONDS_FIRST_WEATHER_RETRY;
+  for (int failure = 1; failure < s_requestFailures && retrySeconds < NUMBER_OF_SECONDS_MAX_WEATHER_RETRY; failure++)
   {
-    if (mondayFirst)
-    {
-      // Monday through Sunday Layout
-      // Have a gap between Friday/Saturday
-      if (dayLoop == 5 || dayLoop == 12)
-      {
-        calendarX = 104;
-      }
-      else if (dayLoop == 6 || dayLoop == 13)
-      {
-        calendarX = 124;
-      }
-      else if (dayLoop < 5)
-      {
-        calendarX = dayLoop * 20;
-      }
-      else
-      {
-        calendarX = (dayLoop - 7) * 20;
-      }
-    }
-    else
-    {
-      // Sunday through Saturday Layout
-      // Have a gap between Sunday/Monday and Friday/Saturday
-      if (dayLoop == 0 || dayLoop == 7)
-      {
-        calendarX = 0;
-      }
-      else if (dayLoop == 6 || dayLoop == 13)
-      {
-        calendarX = 124;
-      }
-      else if (dayLoop < 7)
-      {
-        calendarX = 2 + dayLoop * 20;
-      }
-      else
-      {
-        calendarX = 2 + (dayLoop - 7) * 20;
-      }
-    }
-
-    if (dayLoop < 7)
-    {
-      calendarY = 132;
-    }
-    else
-    {
-      calendarY = 150;
-    }
-    
-    s_calendarDay_layer[dayLoop] = text_layer_create(GRect(calendarX, calendarY, 20, 20));
-    text_layer_set_background_color(s_calendarDay_layer[dayLoop], GColorBlack);
-    text_layer_set_text_color(s_calendarDay_layer[dayLoop], GColorWhite);
-    text_layer_set_font(s_calendarDay_layer[dayLoop], fonts_get_system_font(FONT_KEY_GOTHIC_18)); // FONT_KEY_GOTHIC_18
-    text_layer_set_text_alignment(s_calendarDay_layer[dayLoop], GTextAlignmentCenter);
-    text_layer_set_text(s_calendarDay_layer[dayLoop], "-");
-    layer_add_child(window_get_root_layer(s_main_window), text_layer_get_layer(s_calendarDay_layer[dayLoop]));
-    calendarX += 22;
+    retrySeconds *= 2;
+  }
+  if (retrySeconds > NUMBER_OF_SECONDS_MAX_WEATHER_RETRY)
+  {
+    retrySeconds = NUMBER_OF_SECONDS_MAX_WEATHER_RETRY;
   }
+  s_requestTimer = app_timer_register(retrySeconds * 1000, retry_timer_callback, NULL);
 }
 
-static void destroy_calendar_layers()
+static void request_succeeded()
 {
-  for (int dayLoop = 0; dayLoop < 14; dayLoop++)
-  {
-    text_layer_destroy(s_calendarDay_layer[dayLoop]);
-  }
+  cancel_request_timer();
+  s_requestState = REQUEST_SUCCEEDED;
+  s_requestFailures = 0;
+  timeOfLastWeather = time(NULL);
 }
 
-static void main_window_load(Window *window)
+static void request_timeout_callback(void *data)
 {
-  // Recover saved weather conditions and configuration options.
-  // We will re-query weather, but this is important if we don't
-  // have a data connection when the app reopens.
-  if (persist_exists(STORAGE_KEY_CURRENT_TEMPERATURE_C))
-  {
-    currentTemperature_c = persist_read_int(STORAGE_KEY_CURRENT_TEMPERATURE_C);
-  }
-  else
-  {
-    currentTemperature_c = 0;
-  }
+  // No weather within NUMBER_OF_SECONDS_UNTIL_DATA_CONSIDERED_LOST,
+  // assume that we have lost our data connection.
+  s_requestTimer = NULL;
+  connectedToData = false;
+  update_link_label();
+  request_failed();
+}
 
-  if (persist_exists(STORAGE_KEY_CURRENT_CONDITIONS))
-  {
-    persist_read_string(STORAGE_KEY_CURRENT_CONDITIONS, currentConditions, 32);
-  }
-  else
-  {
-    currentConditions[0] = 0;
-  }
-  
-  if (persist_exists(STORAGE_KEY_CURRENT_DAY_FORECAST_CONDITIONS))
-  {
-    persist_read_string(STORAGE_KEY_CURRENT_DAY_FORECAST_CONDITIONS, currentDayForecastConditions, 32);
-  }
-  else
-  {
-    currentDayForecastConditions[0] = 0;
-  }
-  
-  if (persist_exists(STORAGE_KEY_CURRENT_LOW_C))
-  {
-    currentLowTemperature_c = persist_read_int(STORAGE_KEY_CURRENT_LOW_C);
-  }
-  else
+static void write_weather_request(DictionaryIterator *iter)
+{
+  // With nothing to show, the phone sends what it has cached at once,
+  // even if it is old, and then fetches.
+  dict_write_uint8(iter, KEY_REQUEST_WEATHER, s_state.currentObserved ? 0 : 1);
+}
+
+static void write_counters(DictionaryIterator *iter)
+{
+  uint8_t data[COUNTERS_MESSAGE_SIZE];
+  counters_encode(data);
+  dict_write_data(iter, KEY_COUNTERS, data, sizeof(data));
+}
+
+static void send_weather_request()
+{
+  // Without a phone the request could only fail; don't wake the radio.
+  if (!connectedToBluetooth)
   {
-    currentLowTemperature_c = 0;
+    request_failed();
+    return;
   }
-  
-  if (persist_exists(STORAGE_KEY_CURRENT_HIGH_C))
+
+  // In flight before the push: a message the queue gives up on straight
+  // away fails the request from send_done, and starts the backoff.
+  timeOfLastDataRequest = time(NULL);
+  s_requestState = REQUEST_IN_FLIGHT;
+  cancel_request_timer();
+  s_requestTimer = app_timer_register(NUMBER_OF_SECONDS_UNTIL_DATA_CONSIDERED_LOST * 1000, request_timeout_callback, NULL);
+  if (!send_queue_push(MESSAGE_WEATHER_REQUEST, PRIORITY_WEATHER_REQUEST, write_weather_request))
   {
-    currentHighTemperature_c = persist_read_int(STORAGE_KEY_CURRENT_HIGH_C);
+    request_failed();
   }
-  else
+}
+
+// Ask the phone for the weather, unless a request is already in flight
+// or a failed one is waiting for its retry.
+static void request_weather()
+{
+  if ((s_requestState == REQUEST_IN_FLIGHT) || (s_requestState == REQUEST_FAILED))
   {
-    currentHighTemperature_c = 0;
+    return;
   }
-  
-  if (persist_exists(STORAGE_KEY_CURRENT_WIND_DIR_DEG))
+  send_weather_request();
+}
+
+static void update_bluetooth_state(bool bluetoothConnected)
+{
+  bool reconnected = bluetoothConnected && !connectedToBluetooth;
+  connectedToBluetooth = bluetoothConnected;
+  update_link_label();
+
+  // The phone is back: retry now instead of waiting out the backoff.
+  if (reconnected && (s_requestState == REQUEST_FAILED))
   {
-    currentWindDirection_deg = persist_read_int(STORAGE_KEY_CURRENT_WIND_DIR_DEG);
+    s_requestFailures = 0;
+    send_weather_request();
   }
-  else
+}
+
+// The calendar's layers are created once, when the window loads. A
+// change of week start only moves them, see layout.h.
+static void create_calendar_layers(bool mondayFirst)
+{
+  const CalendarLayout *calendarLayout = layout_calendar(mondayFirst);
+  for (int dayLoop = 0; dayLoop < CALENDAR_DAYS; dayLoop++)
   {
-    currentWindDirection_deg = 0;
+    create_field(FIELD_CALENDAR_DAY + dayLoop, calendarLayout->days[dayLoop], s_calendarFont,
+                 GTextAlignmentCenter, GColorWhite, GColorBlack, "-");
   }
-  
-  if (persist_exists(STORAGE_KEY_CURRENT_WIND_SPD_METERSPERSECOND))
+}
+
+static void move_calendar_layers()
+{
+  const CalendarLayout *calendarLayout = layout_calendar(s_state.mondayFirst == TRUE);
+  for (int dayLoop = 0; dayLoop < CALENDAR_DAYS; dayLoop++)
   {
-    currentWindSpeed_metersPerSecond = persist_read_int(STORAGE_KEY_CURRENT_WIND_SPD_METERSPERSECOND);
+    set_field_frame(FIELD_CALENDAR_DAY + dayLoop, calendarLayout->days[dayLoop]);
   }
-  else
+}
+
+static void destroy_calendar_layers()
+{
+  for (int dayLoop = 0; dayLoop < CALENDAR_DAYS; dayLoop++)
   {
-    currentWindSpeed_metersPerSecond = 0;
+    destroy_field(FIELD_CALENDAR_DAY + dayLoop);
   }
-  
-  if (persist_exists(STORAGE_KEY_CURRENT_DAY))
+}
+
+static int32_t read_legacy_int(const uint32_t key)
+{
+  return persist_exists(key) ? persist_read_int(key) : 0;
+}
+
+// Before the state was one blob, every value had a key of its own.
+// The condition strings are not carried over; the weather request made
+// at launch fills them in again. Today's and tomorrow's forecast go
+// into the ring under the dates they were for.
+static bool migrate_legacy_state()
+{
+  if (!persist_exists(STORAGE_KEY_MONDAY_FIRST))
   {
-    currentDate = persist_read_int(STORAGE_KEY_CURRENT_DAY);
+    return false;
   }
-  else
+
+  s_state.currentTemperature_c = read_legacy_int(STORAGE_KEY_CURRENT_TEMPERATURE_C);
+  s_state.currentWindDirection_deg = read_legacy_int(STORAGE_KEY_CURRENT_WIND_DIR_DEG);
+  s_state.currentWindSpeed_metersPerSecond = read_legacy_int(STORAGE_KEY_CURRENT_WIND_SPD_METERSPERSECOND);
+  s_state.temperatureUnits = read_legacy_int(STORAGE_KEY_TEMPERATURE_UNITS);
+  s_state.windSpeedUnits = read_legacy_int(STORAGE_KEY_WINDSPEED_UNITS);
+  s_state.weekNumberEnabled = read_legacy_int(STORAGE_KEY_WEEKNUMBER_ENABLED);
+  s_state.mondayFirst = read_legacy_int(STORAGE_KEY_MONDAY_FIRST);
+
+  int32_t currentDate = read_legacy_int(STORAGE_KEY_CURRENT_DAY);
+  if (currentDate > 0)
   {
-    currentDate = 0;
+    int32_t today = forecast_local_day(currentDate);
+    forecast_store(&s_state.forecast, today, read_legacy_int(STORAGE_KEY_CURRENT_LOW_C),
+                   read_legacy_int(STORAGE_KEY_CURRENT_HIGH_C), WEATHER_CONDITION_UNKNOWN);
+    forecast_store(&s_state.forecast, today + 1, read_legacy_int(STORAGE_KEY_FORECAST_LOW_C),
+                   read_legacy_int(STORAGE_KEY_FORECAST_HIGH_C), WEATHER_CONDITION_UNKNOWN);
   }
-  
-  if (persist_exists(STORAGE_KEY_FORECAST_LOW_C))
+
+  for (uint32_t key = STORAGE_KEY_CURRENT_TEMPERATURE_C; key <= STORAGE_KEY_MONDAY_FIRST; key++)
   {
-    forecastLowTemperature_c = persist_read_int(STORAGE_KEY_FORECAST_LOW_C);
+    persist_delete(key);
   }
-  else
+  return true;
+}
+
+static void save_state()
+{
+  if (memcmp(&s_state, &s_savedState, sizeof(s_state)) == 0)
   {
-    forecastLowTemperature_c = 0;
+    return;
   }
-  
-  if (persist_exists(STORAGE_KEY_FORECAST_HIGH_C))
+
+  int32_t today = time(NULL) / 86400;
+  if (s_state.writeCountDay != today)
   {
-    forecastHighTemperature_c = persist_read_int(STORAGE_KEY_FORECAST_HIGH_C);
+    s_state.writeCountDay = today;
+    s_state.writesToday = 0;
   }
-  else
+  s_state.writesToday++;
+  s_state.writeCount++;
+
+  persist_write_data(STORAGE_KEY_STATE, &s_state, sizeof(s_state));
+  counters_add(COUNTER_PERSIST_WRITES, 1);
+  s_savedState = s_state;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "State saved, %d writes today, %d total",
+          (int)s_state.writesToday, (int)s_state.writeCount);
+}
+
+static void load_state()
+{
+  if ((persist_get_size(STORAGE_KEY_STATE) == sizeof(s_state)) &&
+      (persist_read_data(STORAGE_KEY_STATE, &s_state, sizeof(s_state)) == sizeof(s_state)) &&
+      (s_state.version == STATE_VERSION))
   {
-    forecastHighTemperature_c = 0;
+    s_savedState = s_state;
+    return;
   }
-  
-  if (persist_exists(STORAGE_KEY_FORECAST_CONDITIONS))
+
+  // Nothing usable in flash: start from the defaults (all zero), and
+  // only write them out once there is something worth keeping.
+  memset(&s_state, 0, sizeof(s_state));
+  s_state.version = STATE_VERSION;
+  s_savedState = s_state;
+
+  if (migrate_legacy_state())
   {
-    persist_read_string(STORAGE_KEY_FORECAST_CONDITIONS, forecastConditions, 32);
+    save_state();
   }
-  else
+}
+
+// What the face showed last, if it was showing it today.
+static bool read_display(int32_t today)
+{
+  int size = persist_read_data(STORAGE_KEY_DISPLAY, &s_display, sizeof(s_display));
+  if (!display_valid(&s_display, size) || (s_display.day != today) || (s_display.todayIndex >= CALENDAR_DAYS))
   {
-    forecastConditions[0] = 0;
+    s_display.version = 0;
+    return false;
   }
+  return true;
+}
+
+static bool is_time_field(int field)
+{
+  return (field == FIELD_TIME) || (field == FIELD_TIME_AM_PM) || (field == FIELD_TIME_SECONDS);
+}
 
-  if (persist_exists(STORAGE_KEY_TEMPERATURE_UNITS))
+static void restore_display()
+{
+  size_t offset = 0;
+  for (int field = 0; field < FIELD_COUNT; field++)
   {
-    temperatureUnits = persist_read_int(STORAGE_KEY_TEMPERATURE_UNITS); 
+    const char *text = display_next(&s_display, &offset);
+    if (!text)
+    {
+      break;
+    }
+    // The seconds field is kept: it is either empty or the week number.
+    if ((field != FIELD_TIME) && (field != FIELD_TIME_AM_PM))
+    {
+      show_field_text(field, text);
+    }
   }
-  else
+  set_field_font(FIELD_CALENDAR_DAY + s_display.todayIndex, s_calendarTodayFont);
+}
+
+// Everything shown but the time, for the next launch. Written when the
+// face closes, and only when it differs from what flash holds.
+static void save_display()
+{
+  DisplaySnapshot display;
+  display_begin(&display, s_calendar.today, s_state.mondayFirst == TRUE, s_calendar.todayIndex);
+  for (int field = 0; field < FIELD_COUNT; field++)
   {
-    temperatureUnits = TEMPERATURE_UNITS_F;
+    const char *text = s_fields[field].text;
+    bool weekNumber = (field == FIELD_TIME_SECONDS) && (s_state.weekNumberEnabled == TRUE);
+    if (!text || (is_time_field(field) && !weekNumber))
+    {
+      text = "";
+    }
+    display_add(&display, text);
   }
-  
-  if (persist_exists(STORAGE_KEY_WINDSPEED_UNITS))
+
+  size_t size = display_size(&display);
+  if ((size == 0) || !s_calendar.valid ||
+      ((size == display_size(&s_display)) && (memcmp(&display, &s_display, size) == 0)))
   {
-    windSpeedUnits = persist_read_int(STORAGE_KEY_WINDSPEED_UNITS);
+    return;
   }
-  else
+  persist_write_data(STORAGE_KEY_DISPLAY, &display, size);
+  counters_add(COUNTER_PERSIST_WRITES, 1);
+  memcpy(&s_display, &display, size);
+}
+
+// The part of a launch that can wait for the first frame: everything
+// but the time.
+static void finish_launch()
+{
+  time_t currentTime = time(NULL);
+  struct tm *tick_time = localtime(&currentTime);
+  // The first frame placed the calendar as the display was saved; the
+  // state decides now.
+  move_calendar_layers();
+  update_date(tick_time);
+  update_seconds(tick_time);
+  update_battery_state(battery_state_service_peek());
+  update_bluetooth_state(bluetooth_connection_service_peek());
+
+  // The weather comes ready made from the worker. Without one, or when
+  // the state changed since, the face prepares it itself.
+  if (!read_snapshot())
   {
-    windSpeedUnits = WINDSPEED_UNITS_KNOTS;
+    prepare_snapshot();
   }
-  
-  if (persist_exists(STORAGE_KEY_WEEKNUMBER_ENABLED))
+  convert_current_weather();
+  update_weather();
+
+  // The phone doesn't send the weather at launch. It is only asked for
+  // once due, after the first frame: a request_weather here crashes the
+  // Pebble Watch.
+  timeOfLastWeather = s_state.currentObserved;
+  if (time(NULL) >= s_snapshot.refreshDue)
   {
-    weekNumberEnabled = persist_read_int(STORAGE_KEY_WEEKNUMBER_ENABLED);
+    s_requestTimer = app_timer_register(0, launch_request_callback, NULL);
   }
-  else
+}
+
+static void launch_timer_callback(void *data)
+{
+  s_launchTimer = NULL;
+  s_launchPending = false;
+  load_state();
+  finish_launch();
+}
+
+// Drawn last, and draws nothing. A timer registered in init may run
+// before the window is first drawn; one registered while it is drawn
+// can only run after.
+static void launch_layer_update_proc(Layer *layer, GContext *ctx)
+{
+  if (s_launchPending && !s_launchTimer)
   {
-    weekNumberEnabled = FALSE;
+    s_launchTimer = app_timer_register(0, launch_timer_callback, NULL);
   }
-  
-  if (persist_exists(STORAGE_KEY_MONDAY_FIRST))
+}
+
+// Handlers that need the state call this first, in case they come
+// before the launch timer.
+static void complete_launch()
+{
+  if (s_launchPending)
   {
-    mondayFirst = persist_read_int(STORAGE_KEY_MONDAY_FIRST);
+    if (s_launchTimer)
+    {
+      app_timer_cancel(s_launchTimer);
+    }
+    launch_timer_callback(NULL);
   }
-  else
+}
+
+static void main_window_load(Window *window)
+{
+  // When the face already showed something today, the first frame is
+  // drawn from that: only the time is worked out, and the state isn't
+  // even loaded until the frame is up. Otherwise everything is worked
+  // out now, from the saved state and configuration.
+  time_t currentTime = time(NULL);
+  struct tm *tick_time = localtime(&currentTime);
+  bool restored = read_display(calendar_days_from_civil(tick_time->tm_year + 1900, tick_time->tm_mon + 1,
+                                                        tick_time->tm_mday));
+  if (!restored)
   {
-    mondayFirst = FALSE;
+    load_state();
   }
+  memset(&s_calendar, 0, sizeof(s_calendar));
+  // Fonts used by the calendar are looked up once and reused.
+  s_calendarFont = fonts_get_system_font(FONT_KEY_GOTHIC_18);
+  s_calendarTodayFont = fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD);
+
+  // Every frame comes from the table for this screen.
+  const Layout *layout = layout_fields();
+
+#if USE_CANVAS_LAYER
+  // One layer draws every field except the time, which has a small
+  // layer of its own so ticks only mark that area dirty. The seconds,
+  // which change on every tick while they are shown, sit on top in a
+  // layer only as big as their field.
+  s_canvas_layer = layer_create(layer_get_bounds(window_get_root_layer(window)));
+  layer_set_update_proc(s_canvas_layer, canvas_update_proc);
+  layer_add_child(window_get_root_layer(window), s_canvas_layer);
+
+  s_time_canvas_layer = layer_create(layout->timeArea);
+  layer_set_update_proc(s_time_canvas_layer, canvas_update_proc);
+  layer_add_child(window_get_root_layer(window), s_time_canvas_layer);
+
+  s_seconds_canvas_layer = layer_create(layout->fields[FIELD_TIME_SECONDS]);
+  layer_set_update_proc(s_seconds_canvas_layer, canvas_update_proc);
+  layer_add_child(window_get_root_layer(window), s_seconds_canvas_layer);
+#endif
 
-  // 144 wide
-  // GRect: x position, y position, x size, y size
-  
   // Create Battery TextLayer
-  s_battery_layer = text_layer_create(GRect(0, 0, 50, 16));
-  text_layer_set_background_color(s_battery_layer, GColorBlack);
-  text_layer_set_text_color(s_battery_layer, GColorWhite);
-  text_layer_set_font(s_battery_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD));
-  text_layer_set_text_alignment(s_battery_layer, GTextAlignmentLeft);
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_battery_layer));
+  create_field(FIELD_BATTERY, layout->fields[FIELD_BATTERY], fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD),
+               GTextAlignmentLeft, GColorWhite, GColorBlack, NULL);
     
   // Create Link Status TextLayer
-  s_linkStatus_layer = text_layer_create(GRect(50, 0, 94, 16));
-  text_layer_set_background_color(s_linkStatus_layer, GColorBlack);
-  text_layer_set_text_color(s_linkStatus_layer, GColorWhite);
-  text_layer_set_font(s_linkStatus_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD));
-  text_layer_set_text_alignment(s_linkStatus_layer, GTextAlignmentLeft);
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_linkStatus_layer));
+  create_field(FIELD_LINK_STATUS, layout->fields[FIELD_LINK_STATUS], fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD),
+               GTextAlignmentLeft, GColorWhite, GColorBlack, NULL);
+
+  // Create Power Profile TextLayer
+  create_field(FIELD_POWER_PROFILE, layout->fields[FIELD_POWER_PROFILE], fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD),
+               GTextAlignmentRight, GColorWhite, GColorBlack, NULL);
   
   // Create Time TextLayer
-  if (clock_is_24h_style())
-  {
-    s_time_layer = text_layer_create(GRect(0, 10, 125, 50));
-  }
-  else
-  {
-    s_time_layer = text_layer_create(GRect(0, 10, 118, 50));
-  }
-  text_layer_set_background_color(s_time_layer, GColorClear);
-  text_layer_set_text_color(s_time_layer, GColorBlack);
-  text_layer_set_font(s_time_layer, fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD));
-  text_layer_set_text_alignment(s_time_layer, GTextAlignmentRight);
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_time_layer));
+  // A 24 hour clock has no AM/PM, so the time can take more room.
+  create_field(FIELD_TIME, clock_is_24h_style() ? layout->time24h : layout->fields[FIELD_TIME],
+               fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD),
+               GTextAlignmentRight, GColorBlack, GColorClear, NULL);
   
   // Create AM/PM TextLayer
-  s_time_am_pm_layer = text_layer_create(GRect(120, 16, 24, 18));
-  text_layer_set_background_color(s_time_am_pm_layer, GColorClear);
-  text_layer_set_text_color(s_time_am_pm_layer, GColorBlack);
-  text_layer_set_font(s_time_am_pm_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(s_time_am_pm_layer, GTextAlignmentLeft);
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_time_am_pm_layer));
+  create_field(FIELD_TIME_AM_PM, layout->fields[FIELD_TIME_AM_PM], fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+               GTextAlignmentLeft, GColorBlack, GColorClear, NULL);
   
   // Create Seconds TextLayer
-  s_time_seconds_layer = text_layer_create(GRect(120, 33, 24, 18));
-  text_layer_set_background_color(s_time_seconds_layer, GColorClear);
-  text_layer_set_text_color(s_time_seconds_layer, GColorBlack);
-  text_layer_set_font(s_time_seconds_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(s_time_seconds_layer, GTextAlignmentLeft);
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_time_seconds_layer));
+  create_field(FIELD_TIME_SECONDS, layout->fields[FIELD_TIME_SECONDS], fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+               GTextAlignmentLeft, GColorBlack, GColorClear, NULL);
   
   // Create Date TextLayer
-  s_date_layer = text_layer_create(GRect(0, 48, 144, 28)); // 0, 43, 144, 28
-  text_layer_set_background_color(s_date_layer, GColorClear);
-  text_layer_set_text_color(s_date_layer, GColorBlack);
-  text_layer_set_font(s_date_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(s_date_layer, GTextAlignmentCenter);
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_date_layer));
+  create_field(FIELD_DATE, layout->fields[FIELD_DATE], fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+               GTextAlignmentCenter, GColorBlack, GColorClear, NULL);
   
   // Create Current Weather Layer
-  s_weather_current_layer = text_layer_create(GRect(2, 73, 142, 20)); // 0, 65, 144, 20
-  text_layer_set_background_color(s_weather_current_layer, GColorClear);
-  text_layer_set_text_color(s_weather_current_layer, GColorBlack);
-  text_layer_set_font(s_weather_current_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
-  text_layer_set_text_alignment(s_weather_current_layer, GTextAlignmentLeft);
-  text_layer_set_text(s_weather_current_layer, "");
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_weather_current_layer));
+  create_field(FIELD_WEATHER_CURRENT, layout->fields[FIELD_WEATHER_CURRENT], fonts_get_system_font(FONT_KEY_GOTHIC_18),
+               GTextAlignmentLeft, GColorBlack, GColorClear, "");
   
   // Create Today's Forecast Label Layer
-  s_weather_label1_layer = text_layer_create(GRect(2, 90, 25, 20)); // 0, 113, 35, 20
-  text_layer_set_background_color(s_weather_label1_layer, GColorClear);
-  text_layer_set_text_color(s_weather_label1_layer, GColorBlack);
-  text_layer_set_font(s_weather_label1_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(s_weather_label1_layer, GTextAlignmentLeft);
-  text_layer_set_text(s_weather_label1_layer, "");
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_weather_label1_layer));
+  create_field(FIELD_WEATHER_LABEL1, layout->fields[FIELD_WEATHER_LABEL1], fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+               GTextAlignmentLeft, GColorBlack, GColorClear, "");
  
   // Create Today's Forecast Layer
-  s_weather_forecast1_layer = text_layer_create(GRect(25, 90, 119, 20)); // 0, 81, 144, 20
-  text_layer_set_background_color(s_weather_forecast1_layer, GColorClear);
-  text_layer_set_text_color(s_weather_forecast1_layer, GColorBlack);
-  text_layer_set_font(s_weather_forecast1_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
-  text_layer_set_text_alignment(s_weather_forecast1_layer, GTextAlignmentLeft);
-  text_layer_set_text(s_weather_forecast1_layer, "");
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_weather_forecast1_layer));
+  create_field(FIELD_WEATHER_FORECAST1, layout->fields[FIELD_WEATHER_FORECAST1], fonts_get_system_font(FONT_KEY_GOTHIC_18),
+               GTextAlignmentLeft, GColorBlack, GColorClear, "");
 
   // Create Tomorrow's Forecast Label Layer
-  s_weather_label2_layer = text_layer_create(GRect(2, 107, 25, 20)); // 0, 113, 35, 20
-  text_layer_set_background_color(s_weather_label2_layer, GColorClear);
-  text_layer_set_text_color(s_weather_label2_layer, GColorBlack);
-  text_layer_set_font(s_weather_label2_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(s_weather_label2_layer, GTextAlignmentLeft);
-  text_layer_set_text(s_weather_label2_layer, "");
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_weather_label2_layer));
+  create_field(FIELD_WEATHER_LABEL2, layout->fields[FIELD_WEATHER_LABEL2], fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+               GTextAlignmentLeft, GColorBlack, GColorClear, "");
 
   // Create Tomorrow's Forecast Layer
-  s_weather_forecast2_layer = text_layer_create(GRect(25, 107, 119, 20)); // 35, 113, 109, 20
-  text_layer_set_background_color(s_weather_forecast2_layer, GColorClear);
-  text_layer_set_text_color(s_weather_forecast2_layer, GColorBlack);
-  text_layer_set_font(s_weather_forecast2_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
-  text_layer_set_text_alignment(s_weather_forecast2_layer, GTextAlignmentLeft);
-  text_layer_set_text(s_weather_forecast2_layer, "");
-  layer_add_child(window_get_root_layer(window), text_layer_get_layer(s_weather_forecast2_layer));
+  create_field(FIELD_WEATHER_FORECAST2, layout->fields[FIELD_WEATHER_FORECAST2], fonts_get_system_font(FONT_KEY_GOTHIC_18),
+               GTextAlignmentLeft, GColorBlack, GColorClear, "");
   
   // Create Calendar Layers
-  create_calendar_layers();
-  
-  // Do an immediate update for all the layers.
-  time_t currentTime = time(NULL);
-  struct tm *tick_time = localtime(&currentTime);
-  update_time(tick_time);
-  update_date(tick_time);
-  update_battery_state(battery_state_service_peek());
-  update_bluetooth_state(bluetooth_connection_service_peek());
-  update_weather();
-  
-  // Cannot do a request_weather here, crashes the Pebble Watch.
+  create_calendar_layers(restored ? s_display.mondayFirst : (s_state.mondayFirst == TRUE));
+
+  update_time(tick_time, SECOND_UNIT | MINUTE_UNIT | HOUR_UNIT | DAY_UNIT);
+  if (restored)
+  {
+    restore_display();
+    s_launchPending = true;
+    s_launchLayer = layer_create(layer_get_bounds(window_get_root_layer(window)));
+    layer_set_update_proc(s_launchLayer, launch_layer_update_proc);
+    layer_add_child(window_get_root_layer(window), s_launchLayer);
+  }
+  else
+  {
+    finish_launch();
+  }
+
+  memory_sample(MEMORY_WINDOW_LOAD);
 }
 
 static void main_window_unload(Window *window)
 {
-  // Record current weather conditions so they can be restored
-  // immediately when the app reopens. Very important if we don't
-  // have a data connection when the app reopens.
-  persist_write_int(STORAGE_KEY_CURRENT_TEMPERATURE_C, currentTemperature_c);
-  persist_write_string(STORAGE_KEY_CURRENT_CONDITIONS, currentConditions);
-  persist_write_string(STORAGE_KEY_CURRENT_DAY_FORECAST_CONDITIONS, currentDayForecastConditions);
-  persist_write_int(STORAGE_KEY_CURRENT_LOW_C, currentLowTemperature_c);
-  persist_write_int(STORAGE_KEY_CURRENT_HIGH_C, currentHighTemperature_c);
-  persist_write_int(STORAGE_KEY_CURRENT_WIND_DIR_DEG, currentWindDirection_deg);
-  persist_write_int(STORAGE_KEY_CURRENT_WIND_SPD_METERSPERSECOND, currentWindSpeed_metersPerSecond);
-  persist_write_int(STORAGE_KEY_CURRENT_DAY, currentDate);
-  persist_write_int(STORAGE_KEY_FORECAST_LOW_C, forecastLowTemperature_c);
-  persist_write_int(STORAGE_KEY_FORECAST_HIGH_C, forecastHighTemperature_c);
-  persist_write_string(STORAGE_KEY_FORECAST_CONDITIONS, forecastConditions);
-  
-  // Record configuration settings.
-  persist_write_int(STORAGE_KEY_TEMPERATURE_UNITS, temperatureUnits);
-  persist_write_int(STORAGE_KEY_WINDSPEED_UNITS, windSpeedUnits);
-  persist_write_int(STORAGE_KEY_WEEKNUMBER_ENABLED, weekNumberEnabled);
-  persist_write_int(STORAGE_KEY_MONDAY_FIRST, mondayFirst);
+  if (s_launchPending)
+  {
+    // Closed before the launch finished: the display is unchanged and
+    // the state was never loaded.
+    if (s_launchTimer)
+    {
+      app_timer_cancel(s_launchTimer);
+      s_launchTimer = NULL;
+    }
+    s_launchPending = false;
+  }
+  else
+  {
+    // Normally a no-op: the state was already saved when it last changed.
+    save_state();
+    save_display();
+  }
 
   // Destroy Layers
-  text_layer_destroy(s_battery_layer);
-  text_layer_destroy(s_linkStatus_layer);
-  text_layer_destroy(s_time_layer);
-  text_layer_destroy(s_time_am_pm_layer);
-  text_layer_destroy(s_time_seconds_layer);
-  text_layer_destroy(s_date_layer);
-  text_layer_destroy(s_weather_current_layer);
-  text_layer_destroy(s_weather_label1_layer);
-  text_layer_destroy(s_weather_forecast1_layer);
-  text_layer_destroy(s_weather_label2_layer);
-  text_layer_destroy(s_weather_forecast2_layer);
+  for (int field = 0; field < FIELD_CALENDAR_DAY; field++)
+  {
+    destroy_field(field);
+  }
   destroy_calendar_layers();
+#if USE_CANVAS_LAYER
+  layer_destroy(s_seconds_canvas_layer);
+  layer_destroy(s_time_canvas_layer);
+  layer_destroy(s_canvas_layer);
+#endif
+  if (s_launchLayer)
+  {
+    layer_destroy(s_launchLayer);
+    s_launchLayer = NULL;
+  }
 }
 
 // tick_handler may be called once per second or once per minute
@@ -801,289 +1105,265 @@ static void main_window_unload(Window *window)
 // the 12 HR clock.
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed)
 {
-  if (isShowingSeconds)
+  complete_launch();
+
+  // While seconds are shown, 59 ticks out of 60 only change the seconds.
+  if (!(units_changed & MINUTE_UNIT))
   {
-    if (difftime(time(NULL), timeOfLastTap) > NUMBER_OF_SECONDS_TO_SHOW_SECONDS_AFTER_TAP)
-    {
-      // We are showing seconds, but it has been more than 5
-      // minutes since our wrist was tapped. To save processing,
-      // stop showing seconds (revert back to one minute updates).
-      isShowingSeconds = false;
-      tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
-    }
+    counters_add(COUNTER_SECOND_TICKS, 1);
+    update_seconds(tick_time);
+    return;
   }
+  counters_add(COUNTER_MINUTE_TICKS, 1);
 
-  // Update the time.
-  update_time(tick_time);
-
-  // Update the date only when the day changes.
-  if (lastCalendarDateUpdatedTo != tick_time->tm_mday)
+  // Update the date only when the day changes. The date goes first, as
+  // it also works out the week number shown next to the time.
+  bool newDay = lastCalendarDateUpdatedTo != tick_time->tm_mday;
+  if (newDay)
   {
     update_date(tick_time);
-
-    // Also request the weather again so we get the next day's forecast.
-    request_weather();
   }
 
-  // Update the weather every 30 minutes.
-  if (difftime(time(NULL), timeOfLastDataRequest) > NUMBER_OF_SECONDS_BETWEEN_WEATHER_UPDATES)
+  // Update the time.
+  update_time(tick_time, units_changed);
+  update_seconds(tick_time);
+
+  // Today's and tomorrow's forecast are already in the ring, and the
+  // estimated temperature moves on with the clock while the last one
+  // received is stale.
+  time_t now = time(NULL);
+  int temperature_c = snapshot_temperature(&s_state, now);
+  if (newDay)
   {
-    request_weather();
+    prepare_snapshot();
+    convert_current_weather();
+    update_weather();
+  }
+  else if (temperature_c != s_snapshot.temperature_c)
+  {
+    s_snapshot.temperature_c = temperature_c;
+    convert_current_weather();
+    update_weather();
   }
 
-  // If we haven't received our weather request within 1 minute,
-  // assume that we have lost our data connection.
-  if (connectedToData && 
-      (difftime(timeOfLastDataResponse, timeOfLastDataRequest) > NUMBER_OF_SECONDS_UNTIL_DATA_CONSIDERED_LOST))
+  // Update the weather every 30 minutes, counted from the last request
+  // or the last weather received. While the hourly forecast covers the
+  // next hours it can stand in for the current temperature, so the
+  // weather is fetched less often.
+  uint32_t interval = snapshot_refresh_interval(&s_state, now, power_profile(s_powerProfile));
+  time_t lastWeatherActivity = timeOfLastWeather > timeOfLastDataRequest ? timeOfLastWeather : timeOfLastDataRequest;
+  if (difftime(now, lastWeatherActivity) > interval)
   {
-    connectedToData = false;
-    update_link_label();
+    request_weather();
   }
 }
 
 static void inbox_received_callback(DictionaryIterator *iterator, void *context)
 {
-  // We received data, update the time stamp / link label.
-  timeOfLastDataResponse = time(NULL);
+  complete_launch();
+
+  // We received data, update the link label.
   connectedToData = true;
   update_link_label();
 
+  counters_add(COUNTER_INBOX_MESSAGES, 1);
+  counters_add(COUNTER_INBOX_BYTES, (const uint8_t *)iterator->end - (const uint8_t *)iterator->dictionary);
+
   // Read first item
   Tuple *t = dict_read_first(iterator);
 
-  int day1Date = 0;
-  int day2Date = 0;
-  //int day3Date = 0;
-  int day1LowTemperature_c = 0;
-  int day2LowTemperature_c = 0;
-  int day3LowTemperature_c = 0;
-  int day1HighTemperature_c = 0;
-  int day2HighTemperature_c = 0;
-  int day3HighTemperature_c = 0;
-  char day1Conditions[32];
-  char day2Conditions[32];
-  char day3Conditions[32];
-
-  bool recreateCalendarLayers = false;
-  
+  WeatherReport report;
+  report.flags = 0;
+
+  ConfigMessage config;
+  config_begin(&config);
+  bool configReceived = false;
+
   // For all items
   while(t != NULL)
   {
     // Which key was received?
     switch(t->key)
     {
-      case KEY_TEMPERATURE:
-        currentTemperature_c = t->value->int32;
-        break;
-//      case KEY_CONDITIONS:
-//        // Current conditions (abbreviated).
-//        snprintf(conditions_buffer, sizeof(conditions_buffer), "%s", t->value->cstring);
-//        break;
-//      case KEY_TEMP_MIN:
-//        // Not reliably low temperature.
-//        snprintf(temperatureMin_buffer, sizeof(temperatureMin_buffer), "%d", getFahrenheitFromCelsius(t->value->int32));
-//        break;
-//      case KEY_TEMP_MAX:
-//        // Not reliably high temperature.
-//        snprintf(temperatureMax_buffer, sizeof(temperatureMax_buffer), "%dF", getFahrenheitFromCelsius(t->value->int32));
-//        break;
-      case KEY_WIND_SPEED:
-        // Reported in meters per second, convert to knots.
-        currentWindSpeed_metersPerSecond = t->value->int32;
-        break;
-      case KEY_WIND_DIRECTION:
-        currentWindDirection_deg = t->value->int32;
-        break;
-//      case KEY_HUMIDITY:
-//        snprintf(humidity_buffer, sizeof(humidity_buffer), "%d%%", (int)t->value->int32);
-//        break;
-      case KEY_DESCRIPTION:
-        // Similar to conditions, but far more descriptive.
-        strncpy(currentConditions, t->value->cstring, 32);
-        break;
-      case KEY_DAY1_TIME:
-        // Usually today's date, but in the morning it's yesterday's!
-        day1Date = t->value->int32;
-        break;
-      case KEY_DAY1_CONDITIONS:
-        // Today's condition (abbreviated).
-        //snprintf(day1_conditions_buffer, sizeof(day1_conditions_buffer), "%s", t->value->cstring);
-        strncpy(day1Conditions, t->value->cstring, 32);
-        break;
-      case KEY_DAY1_TEMP_MIN:
-        //currentLowTemperature_c = t->value->int32;
-        day1LowTemperature_c = t->value->int32;
-        break;
-      case KEY_DAY1_TEMP_MAX:
-        //currentHighTemperature_c = t->value->int32;
-        day1HighTemperature_c = t->value->int32;
-        break;
-      case KEY_DAY2_TIME:
-        // Usually it's tomorrow's date, but in the morning it's today's!.
-        //forecastDate = t->value->int32;
-        day2Date = t->value->int32;
-        break;
-      case KEY_DAY2_CONDITIONS:
-        // Forecast condition (abbreviated).
-        //strncpy(forecastConditions, t->value->cstring, 32);
-        strncpy(day2Conditions, t->value->cstring, 32);
-        break;
-      case KEY_DAY2_TEMP_MIN:
-        //forecastLowTemperature_c = t->value->int32;
-        day2LowTemperature_c = t->value->int32;
-        break;
-      case KEY_DAY2_TEMP_MAX:
-        //forecastHighTemperature_c = t->value->int32;
-        day2HighTemperature_c = t->value->int32;
-        break;
-      case KEY_DAY3_TIME:
-        // Usually it's in two days, but in the morning it's tomorrow's!
-        //day3Date = t->value->int32;
-        break;
-      case KEY_DAY3_CONDITIONS:
-        // Forecast condition (abbreviated).
-        strncpy(day3Conditions, t->value->cstring, 32);
-        break;
-      case KEY_DAY3_TEMP_MIN:
-        //day3LowTemperature_c = t->value->int32;
-        day3LowTemperature_c = t->value->int32;
-        break;
-      case KEY_DAY3_TEMP_MAX:
-        day3HighTemperature_c = t->value->int32;
-        break;
-      case CONFIG_KEY_TEMPERATURE_UNITS:
-        if (strcmp(t->value->cstring, "F") == 0)
-        {
-          temperatureUnits = TEMPERATURE_UNITS_F;
-        }
-        else if (strcmp(t->value->cstring, "C") == 0)
-        {
-          temperatureUnits = TEMPERATURE_UNITS_C;
-        }
-        break;
-      case CONFIG_KEY_WINDSPEED_UNITS:
-        if (strcmp(t->value->cstring, "KNOTS") == 0)
-        {
-          windSpeedUnits = WINDSPEED_UNITS_KNOTS;
-        }
-        else if (strcmp(t->value->cstring, "MPH") == 0)
+      case KEY_WEATHER:
+        if (weather_decode(t->value->data, t->length, &report))
         {
-          windSpeedUnits = WINDSPEED_UNITS_MPH;
+          request_succeeded();
         }
-        else if (strcmp(t->value->cstring, "KPH") == 0)
+        else
         {
-          windSpeedUnits = WINDSPEED_UNITS_KPH;
+          APP_LOG(APP_LOG_LEVEL_ERROR, "Weather message not understood!");
+          report.flags = 0;
         }
         break;
-      case CONFIG_KEY_WEEKNUMBER_ENABLED:
-        if (strcmp(t->value->cstring, "DISABLED") == 0)
-        {
-          weekNumberEnabled = FALSE;
-        }
-        else if (strcmp(t->value->cstring, "ENABLED") == 0)
-        {
-          weekNumberEnabled = TRUE;
-        }
+      case KEY_REQUEST_COUNTERS:
+        send_queue_push(MESSAGE_COUNTERS, PRIORITY_COUNTERS, write_counters);
         break;
-      case CONFIG_KEY_MONDAY_FIRST:
-        if (strcmp(t->value->cstring, "DISABLED") == 0)
+      default:
+        if (config_read(&config, t))
         {
-          if (mondayFirst == TRUE)
-          {
-            // Setting changed, flag to recreate the calendar layers.
-            recreateCalendarLayers = true;
-          }
-          mondayFirst = FALSE;
+          configReceived = true;
         }
-        else if (strcmp(t->value->cstring, "ENABLED") == 0)
+        else
         {
-          if (mondayFirst == FALSE)
-          {
-            // Setting changed, flag to recreate the calendar layers.
-            recreateCalendarLayers = true;
-          }
-          mondayFirst = TRUE;
+          APP_LOG(APP_LOG_LEVEL_ERROR, "Key %d not recognized!", (int)t->key);
         }
         break;
-      default:
-        APP_LOG(APP_LOG_LEVEL_ERROR, "Key %d not recognized!", (int)t->key);
-        break;
     }
 
     // Look for next item
     t = dict_read_next(iterator);
   }
 
-  if (day1Date > 0)
+  if (report.flags & WEATHER_HAS_CURRENT)
   {
-    // Forecast Response
-    time_t currentTime = time(NULL);
-    struct tm *currentCalendarTime = localtime(&currentTime);
-    int dayOfMonthCurrent = currentCalendarTime->tm_mday;
-    
-    time_t day1Date_t = day1Date;
-    struct tm *day1CalendarTime = localtime(&day1Date_t);
-    int dayOfMonth1 = day1CalendarTime->tm_mday;
-    
-    time_t day2Date_t = day2Date;
-    struct tm *day2CalendarTime = localtime(&day2Date_t);
-    int dayOfMonth2 = day2CalendarTime->tm_mday;
-    
-    if (dayOfMonthCurrent == dayOfMonth1)
+    s_state.currentTemperature_c = report.temperature_c;
+    s_state.currentObserved = time(NULL);
+    s_state.currentWindSpeed_metersPerSecond = report.windSpeed_metersPerSecond;
+    s_state.currentWindDirection_deg = report.windDirection_deg;
+    // Similar to conditions, but far more descriptive.
+    s_state.currentConditions = weather_condition_code(report.conditionId);
+  }
+
+  if (report.flags & WEATHER_HAS_FORECAST)
+  {
+    // Every day the phone sent goes into the ring under its local date.
+    // Day 1 is usually today, but in the morning it's yesterday; which
+    // days are shown is worked out from the date when drawing.
+    for (int dayIndex = 0; dayIndex < WEATHER_FORECAST_DAYS; dayIndex++)
     {
-      // Day 1 is Today's Date
-      currentDate = day1Date;
-      
-      strncpy(currentDayForecastConditions, day1Conditions, 32);
-      currentLowTemperature_c = day1LowTemperature_c;
-      currentHighTemperature_c = day1HighTemperature_c;
-      
-      // So Day 2 will be the forecast.
-      strncpy(forecastConditions, day2Conditions, 32);
-      forecastLowTemperature_c = day2LowTemperature_c;
-      forecastHighTemperature_c = day2HighTemperature_c;
+      const WeatherDay *day = &report.days[dayIndex];
+      if (day->time > 0)
+      {
+        forecast_store(&s_state.forecast, forecast_local_day(day->time), day->low_c, day->high_c,
+                       weather_condition_code(day->conditionId));
+      }
     }
-    else if (dayOfMonthCurrent == dayOfMonth2)
+  }
+
+  if (report.flags & WEATHER_HAS_HOURLY)
+  {
+    s_state.hourly = report.hourly;
+  }
+
+  // Only what depends on a setting that changed is redrawn.
+  uint8_t views = 0;
+  if (configReceived)
+  {
+    views = config_apply(&config, &s_state);
+    if (!config.valid || (config.version != CONFIG_SCHEMA_VERSION))
     {
-      // Day 2 is Today's Date 
-      currentDate = day2Date;
-      
-      strncpy(currentDayForecastConditions, day2Conditions, 32);
-      currentLowTemperature_c = day2LowTemperature_c;
-      currentHighTemperature_c = day2HighTemperature_c;
-
-      // So Day 3 will be the forecast.
-      strncpy(forecastConditions, day3Conditions, 32);
-      forecastLowTemperature_c = day3LowTemperature_c;
-      forecastHighTemperature_c = day3HighTemperature_c;
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Configuration not understood!");
     }
-  } // (day1Date > 0)
+  }
 
-  if (recreateCalendarLayers)
+  if (views & (CONFIG_VIEW_CALENDAR | CONFIG_VIEW_SECONDS))
   {
-    destroy_calendar_layers();
-    create_calendar_layers();
     time_t currentTime = time(NULL);
     struct tm *tick_time = localtime(&currentTime);
-    update_date(tick_time);
+    if (views & CONFIG_VIEW_CALENDAR)
+    {
+      move_calendar_layers();
+      update_date(tick_time);
+    }
+    update_seconds(tick_time);
   }
-  
-  update_weather();
+
+  if (report.flags)
+  {
+    // New weather: everything it shows.
+    prepare_snapshot();
+    convert_current_weather();
+    update_weather();
+  }
+  else
+  {
+    if (views & CONFIG_VIEW_CURRENT_WEATHER)
+    {
+      convert_current_weather();
+      update_current_weather();
+    }
+    if (views & CONFIG_VIEW_FORECAST)
+    {
+      update_forecast();
+    }
+  }
+
+  // Checkpoint now rather than on unload, so nothing is lost if the
+  // app is killed.
+  save_state();
+
+  memory_sample(MEMORY_INBOX);
 }
 
 static void inbox_dropped_callback(AppMessageResult reason, void *context)
 {
   APP_LOG(APP_LOG_LEVEL_ERROR, "Message dropped!");  
+  counters_add(COUNTER_INBOX_DROPPED, 1);
 }
 
 static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context)
 {
   APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox send failed!");
+  counters_add(COUNTER_OUTBOX_FAILED, 1);
+  send_queue_outbox_failed(reason);
 }
 
 static void outbox_sent_callback(DictionaryIterator *iterator, void *context)
 {
   APP_LOG(APP_LOG_LEVEL_INFO, "Outbox send success!");
+  counters_add(COUNTER_OUTBOX_SENT, 1);
+  send_queue_outbox_sent();
+}
+
+// The worker saved a new snapshot just as the face opened, or has just
+// started and missed the face saying it is open.
+static void worker_message_handler(uint16_t type, AppWorkerMessage *data)
+{
+  complete_launch();
+  if (type == WORKER_MESSAGE_HELLO)
+  {
+    AppWorkerMessage message = { 0 };
+    app_worker_send_message(WORKER_MESSAGE_FACE_OPEN, &message);
+  }
+  else if ((type == WORKER_MESSAGE_SNAPSHOT) && read_snapshot())
+  {
+    convert_current_weather();
+    update_weather();
+  }
+}
+
+// A queued message was delivered, or given up after its retries.
+static void send_done(uint8_t purpose, bool delivered)
+{
+  if ((purpose == MESSAGE_WEATHER_REQUEST) && !delivered && (s_requestState == REQUEST_IN_FLIGHT))
+  {
+    request_failed();
+  }
+}
+
+static void stop_showing_seconds()
+{
+  if (s_secondsTimer)
+  {
+    app_timer_cancel(s_secondsTimer);
+    s_secondsTimer = NULL;
+  }
+  isShowingSeconds = false;
+  tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
+  counters_add(COUNTER_SECONDS_SHOWN, time(NULL) - timeSecondsShownSince);
+
+  time_t currentTime = time(NULL);
+  update_seconds(localtime(&currentTime));
+}
+
+static void seconds_timer_callback(void *data)
+{
+  // It has been a while since our wrist was tapped. To save processing,
+  // stop showing seconds (revert back to one minute updates). A timer
+  // rather than a check on every tick keeps the per-second path short.
+  s_secondsTimer = NULL;
+  stop_showing_seconds();
 }
 
 static void accel_tap_handler(AccelAxisType axis, int32_t direction)
@@ -1099,26 +1379,87 @@ static void accel_tap_handler(AccelAxisType axis, int32_t direction)
   timeOfLastTap = time(NULL);
   
   // The 24 HR clock never shows seconds.
-  if ((weekNumberEnabled == FALSE) && !clock_is_24h_style())
+  if ((s_state.weekNumberEnabled == FALSE) && !s_clock24h)
   {
     if (!isShowingSeconds)
     {
       // We aren't showing seconds, let's show them and switch
       // to the second_unit timer subscription.
       isShowingSeconds = true;
+      timeSecondsShownSince = timeOfLastTap;
       
       // Immediatley update the time so our tap looks very responsive.
       struct tm *tick_time = localtime(&timeOfLastTap);
-      update_time(tick_time);
+      update_seconds(tick_time);
 
       // Resubsrcibe to the tick timer at every second.
       tick_timer_service_subscribe(SECOND_UNIT, tick_handler);
+      s_secondsTimer = app_timer_register(power_profile(s_powerProfile)->secondsAfterTap * 1000,
+                                          seconds_timer_callback, NULL);
+    }
+    else
+    {
+      // Another tap keeps the seconds for longer.
+      app_timer_reschedule(s_secondsTimer, power_profile(s_powerProfile)->secondsAfterTap * 1000);
     }
   }
 }
 
+static void set_power_profile(PowerProfileId profile)
+{
+  static char profileBuffer[8];
+  PowerProfileId previous = s_powerProfile;
+  s_powerProfile = profile;
+  const PowerProfile *settings = power_profile(profile);
+  APP_LOG(APP_LOG_LEVEL_INFO, "Power profile %d", (int)profile);
+
+  // Only listen for taps while they do something.
+  bool wantTaps = settings->secondsAfterTap > 0;
+  if (wantTaps && !s_tapsSubscribed)
+  {
+    accel_tap_service_subscribe(accel_tap_handler);
+  }
+  else if (!wantTaps && s_tapsSubscribed)
+  {
+    accel_tap_service_unsubscribe();
+  }
+  s_tapsSubscribed = wantTaps;
+
+  // Seconds shown now stop no later than the new profile allows,
+  // counted from the last tap, and never later than they would have.
+  if (isShowingSeconds)
+  {
+    if (wantTaps)
+    {
+      if (settings->secondsAfterTap < power_profile(previous)->secondsAfterTap)
+      {
+        int32_t remaining = timeOfLastTap + settings->secondsAfterTap - time(NULL);
+        app_timer_reschedule(s_secondsTimer, remaining > 0 ? remaining * 1000 : 0);
+      }
+    }
+    else
+    {
+      stop_showing_seconds();
+    }
+  }
+
+  set_field_text(FIELD_POWER_PROFILE, profileBuffer, sizeof(profileBuffer), settings->name);
+}
+
 static void init(void)
 {
+  // Before anything else, so every handler's stack use is seen.
+  memory_paint_stack();
+
+  counters_load(STORAGE_KEY_COUNTERS);
+  counters_add(COUNTER_LAUNCHES, 1);
+  isShowingSeconds = false;
+  s_tapsSubscribed = false;
+  s_powerProfile = POWER_PROFILE_COUNT; // Chosen when the window loads.
+  s_requestState = REQUEST_IDLE;
+  s_requestFailures = 0;
+  send_queue_init(send_done);
+
   // Create main Window element and assign to pointer
   s_main_window = window_create();
 
@@ -1138,24 +1479,74 @@ static void init(void)
 
   battery_state_service_subscribe(update_battery_state);
   bluetooth_connection_service_subscribe(update_bluetooth_state);
-  accel_tap_service_subscribe(accel_tap_handler);
   
   app_message_register_inbox_received(inbox_received_callback);
   app_message_register_inbox_dropped(inbox_dropped_callback);
   app_message_register_outbox_failed(outbox_failed_callback);
   app_message_register_outbox_sent(outbox_sent_callback);
   
-  app_message_open(app_message_inbox_size_maximum(), app_message_outbox_size_maximum());
+  // Size the buffers for the largest messages actually exchanged rather
+  // than the maximum: the weather byte array or the configuration
+  // message's integers, every setting and its version (see config.h),
+  // coming in, and a weather request or the counters going out.
+  _Static_assert(CONFIG_SETTING_COUNT == 4, "Size the configuration message for every setting");
+  uint32_t weatherSize = dict_calc_buffer_size(1, WEATHER_MESSAGE_SIZE);
+  uint32_t configSize = dict_calc_buffer_size(CONFIG_SETTING_COUNT + 1, sizeof(int32_t), sizeof(int32_t),
+                                              sizeof(int32_t), sizeof(int32_t), sizeof(int32_t));
+  app_message_open(weatherSize > configSize ? weatherSize : configSize,
+                   dict_calc_buffer_size(1, COUNTERS_MESSAGE_SIZE));
+
+  // The worker keeps the snapshot current while the face isn't running.
+  // Only one app's worker runs at a time, and launching over another
+  // app's asks the user, so it is launched once, on the first run; after
+  // that the watch starts it, or the user chose another. Without it the
+  // face prepares the snapshot itself.
+  app_worker_message_subscribe(worker_message_handler);
+  if (!app_worker_is_running() && !persist_exists(STORAGE_KEY_WORKER_LAUNCH))
+  {
+    persist_write_int(STORAGE_KEY_WORKER_LAUNCH, app_worker_launch());
+  }
+  AppWorkerMessage message = { 0 };
+  app_worker_send_message(WORKER_MESSAGE_FACE_OPEN, &message);
+
+  memory_sample(MEMORY_INIT);
 }
 
 void deinit(void)
 {
+  if (s_secondsTimer)
+  {
+    app_timer_cancel(s_secondsTimer);
+    s_secondsTimer = NULL;
+  }
+  if (isShowingSeconds)
+  {
+    counters_add(COUNTER_SECONDS_SHOWN, time(NULL) - timeSecondsShownSince);
+  }
+  cancel_request_timer();
+  send_queue_deinit();
+  app_worker_message_unsubscribe();
   tick_timer_service_unsubscribe();
   battery_state_service_unsubscribe();
   bluetooth_connection_service_unsubscribe();
-  accel_tap_service_unsubscribe();
+  if (s_tapsSubscribed)
+  {
+    accel_tap_service_unsubscribe();
+    s_tapsSubscribed = false;
+  }
   
   window_destroy(s_main_window);
+
+  // The state is saved: the worker takes over from here.
+  AppWorkerMessage message = { 0 };
+  app_worker_send_message(WORKER_MESSAGE_FACE_CLOSED, &message);
+
+  // Last, so the state saved on unload is counted.
+  counters_save(STORAGE_KEY_COUNTERS);
+  memory_log();
+  const SendQueueStats *sendStats = send_queue_stats();
+  APP_LOG(APP_LOG_LEVEL_INFO, "Messages sent: %d delivered, %d retried, %d dropped",
+          (int)sendStats->delivered, (int)sendStats->retried, (int)sendStats->dropped);
 }
 
 int main(void)
@@ -1163,4 +1554,5 @@ int main(void)
   init();
   app_event_loop();
   deinit();
+  return 0;
 }
@@ -0,0 +1,100 @@
+#include "memory.h"
+
+#define STACK_PAINT 0xA5
+
+// Bytes left alone just below the sampling function's own frame when
+// painting again, for whatever the compiler keeps there.
+#define STACK_PAINT_MARGIN 64
+
+static MemoryRecord s_records[MEMORY_PHASE_COUNT];
+// Kept as plain addresses: the painted area is below the live stack,
+// outside any object the compiler knows of.
+static uintptr_t s_paintLow;          // Lowest painted byte.
+static uintptr_t s_paintHigh;         // Just above the highest.
+
+static const char *const s_phaseNames[MEMORY_PHASE_COUNT] = {
+  "init", "window load", "inbox", "calendar",
+};
+
+// Not inlined, so its array sits just below init's frame. The paint
+// outlives the call: nothing writes there until the stack grows again.
+__attribute__((noinline)) void memory_paint_stack(void)
+{
+  volatile uint8_t area[MEMORY_STACK_PAINT_BYTES];
+  for (size_t i = 0; i < sizeof(area); i++)
+  {
+    area[i] = STACK_PAINT;
+  }
+  s_paintLow = (uintptr_t)area;
+  s_paintHigh = s_paintLow + sizeof(area);
+}
+
+// The stack grows down, so the deepest use is the lowest byte no longer
+// painted. The free part below this frame is painted again afterwards.
+static __attribute__((noinline)) uint32_t measure_and_repaint_stack(void)
+{
+  if (!s_paintLow)
+  {
+    return 0;
+  }
+
+  uintptr_t deepest = s_paintLow;
+  while ((deepest < s_paintHigh) && (*(volatile uint8_t *)deepest == STACK_PAINT))
+  {
+    deepest++;
+  }
+
+  volatile uint8_t here = 0;
+  uintptr_t limit = (uintptr_t)&here - STACK_PAINT_MARGIN;
+  for (uintptr_t byte = s_paintLow; (byte < limit) && (byte < s_paintHigh); byte++)
+  {
+    *(volatile uint8_t *)byte = STACK_PAINT;
+  }
+  return s_paintHigh - deepest;
+}
+
+void memory_sample(MemoryPhase phase)
+{
+  MemoryRecord *record = &s_records[phase];
+  uint32_t stack = measure_and_repaint_stack();
+  record->heapUsed = heap_bytes_used();
+  record->heapFree = heap_bytes_free();
+  if ((record->samples == 0) || (record->heapUsed > record->heapUsedPeak))
+  {
+    record->heapUsedPeak = record->heapUsed;
+  }
+  if ((record->samples == 0) || (record->heapFree < record->heapFreeLow))
+  {
+    record->heapFreeLow = record->heapFree;
+  }
+  if (stack > record->stackPeak)
+  {
+    record->stackPeak = stack;
+  }
+  record->samples++;
+}
+
+const MemoryRecord *memory_record(MemoryPhase phase)
+{
+  return &s_records[phase];
+}
+
+const char *memory_phase_name(MemoryPhase phase)
+{
+  return s_phaseNames[phase];
+}
+
+void memory_log(void)
+{
+  for (int phase = 0; phase < MEMORY_PHASE_COUNT; phase++)
+  {
+    const MemoryRecord *record = &s_records[phase];
+    if (record->samples)
+    {
+      APP_LOG(APP_LOG_LEVEL_INFO, "Memory %s: %d samples, heap %d used (peak %d), %d free (low %d), stack %d%s",
+              s_phaseNames[phase], (int)record->samples, (int)record->heapUsed, (int)record->heapUsedPeak,
+              (int)record->heapFree, (int)record->heapFreeLow, (int)record->stackPeak,
+              (record->stackPeak >= MEMORY_STACK_PAINT_BYTES) ? "+" : "");
+    }
+  }
+}
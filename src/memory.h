@@ -0,0 +1,54 @@
+#pragma once
+
+#include <pebble.h>
+
+// Heap and stack high-water marks, sampled at the points of the app's
+// life where memory use changes: after init, after the window loads,
+// after each inbox message and after each calendar rebuild. Sampling
+// is a few reads and a scan of the painted stack, cheap enough to stay
+// in every build; the results are logged when the app exits, and the
+// host simulation prints them in its report.
+//
+// The stack is painted with a known byte below init's frame. Everything
+// the handlers use below that point overwrites the paint, so the
+// deepest byte not still painted gives the stack depth. After each
+// sample the free part is painted again, so a sample sees the deepest
+// use since the one before it, drawing included.
+
+// Well inside an Aplite app's stack. The host build paints more, since
+// its frames are larger and the simulator's own calls sit in between.
+#ifndef MEMORY_STACK_PAINT_BYTES
+#define MEMORY_STACK_PAINT_BYTES 1024
+#endif
+
+typedef enum
+{
+  MEMORY_INIT,
+  MEMORY_WINDOW_LOAD,
+  MEMORY_INBOX,
+  MEMORY_CALENDAR,
+  MEMORY_PHASE_COUNT,
+} MemoryPhase;
+
+typedef struct
+{
+  uint32_t samples;
+  uint32_t heapUsed;          // At the last sample.
+  uint32_t heapFree;
+  uint32_t heapUsedPeak;      // The most used, and the least free, at
+  uint32_t heapFreeLow;       // any sample.
+  uint32_t stackPeak;         // Bytes below init's frame, at most
+                              // MEMORY_STACK_PAINT_BYTES, which means
+                              // the paint ran out.
+} MemoryRecord;
+
+// First thing in init.
+void memory_paint_stack(void);
+
+void memory_sample(MemoryPhase phase);
+
+const MemoryRecord *memory_record(MemoryPhase phase);
+const char *memory_phase_name(MemoryPhase phase);
+
+// One APP_LOG line per phase sampled.
+void memory_log(void);
@@ -0,0 +1,38 @@
+#include "power.h"
+
+// Battery readings come in 10% steps.
+#define POWER_HYSTERESIS_PERCENT 10
+
+static const PowerProfile s_profiles[POWER_PROFILE_COUNT] = {
+  [POWER_NORMAL] = { "", 1800, 7200, 180 },
+  [POWER_SAVER] = { "Saver", 3600, 10800, 60 },
+  // Taps are switched off altogether, so the accelerometer never wakes
+  // the watch.
+  [POWER_CRITICAL] = { "Low", 10800, 21600, 0 },
+};
+
+PowerProfileId power_profile_select(PowerProfileId current, BatteryChargeState state)
+{
+  if (state.is_charging || state.is_plugged)
+  {
+    return POWER_NORMAL;
+  }
+
+  int percent = state.charge_percent;
+  if ((percent <= POWER_CRITICAL_PERCENT) ||
+      ((current == POWER_CRITICAL) && (percent < POWER_CRITICAL_PERCENT + POWER_HYSTERESIS_PERCENT)))
+  {
+    return POWER_CRITICAL;
+  }
+  if ((percent <= POWER_SAVER_PERCENT) ||
+      (((current == POWER_SAVER) || (current == POWER_CRITICAL)) && (percent < POWER_SAVER_PERCENT + POWER_HYSTERESIS_PERCENT)))
+  {
+    return POWER_SAVER;
+  }
+  return POWER_NORMAL;
+}
+
+const PowerProfile *power_profile(PowerProfileId profile)
+{
+  return &s_profiles[profile];
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "sdk.h"
+
+// Power profiles, picked from the battery state. The lower the charge,
+// the less often the weather is fetched and the less the watch wakes
+// up for taps. On the charger the watch always runs the normal profile.
+//
+// Each profile is entered at its threshold and only left once the charge
+// is a 10% step above it, so a battery reading that wavers around a
+// threshold doesn't flip the profile back and forth.
+
+typedef enum
+{
+  POWER_NORMAL,
+  POWER_SAVER,
+  POWER_CRITICAL,
+  POWER_PROFILE_COUNT,
+} PowerProfileId;
+
+#define POWER_SAVER_PERCENT 30
+#define POWER_CRITICAL_PERCENT 10
+
+typedef struct
+{
+  const char *name;                  // Shown in the status bar, "" for normal.
+  uint16_t weatherInterval_seconds;  // Between weather requests,
+  uint16_t coveredInterval_seconds;  // ...or while the hourly forecast covers the next hours.
+  uint16_t secondsAfterTap;          // 0 = a tap doesn't show seconds.
+} PowerProfile;
+
+// The profile to run next, given the one running now.
+PowerProfileId power_profile_select(PowerProfileId current, BatteryChargeState state);
+
+const PowerProfile *power_profile(PowerProfileId profile);
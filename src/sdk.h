@@ -0,0 +1,10 @@
+#pragma once
+
+// The Pebble API, for the modules the background worker shares with the
+// face. The worker is built against pebble_worker.h, which has the
+// services they use but nothing for the display.
+#ifdef PEBBLE_WORKER
+#include <pebble_worker.h>
+#else
+#include <pebble.h>
+#endif
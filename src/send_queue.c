@@ -0,0 +1,188 @@
+#include "send_queue.h"
+
+#define FIRST_RETRY_MS 500
+
+typedef struct
+{
+  uint8_t purpose;
+  uint8_t priority;
+  uint8_t attempts;
+  SendQueueWriter writer;
+} QueuedMessage;
+
+// s_queue[0] is the message being sent or waiting for its retry.
+static QueuedMessage s_queue[SEND_QUEUE_SIZE];
+static int s_count;
+static bool s_inFlight;
+static AppTimer *s_retryTimer;
+static SendQueueDone s_done;
+static SendQueueStats s_stats;
+
+static void send_next();
+
+static void remove_message(int index)
+{
+  memmove(&s_queue[index], &s_queue[index + 1], (s_count - index - 1) * sizeof(s_queue[0]));
+  s_count--;
+}
+
+static void finish_head(bool delivered)
+{
+  uint8_t purpose = s_queue[0].purpose;
+  remove_message(0);
+  s_inFlight = false;
+
+  if (delivered)
+  {
+    s_stats.delivered++;
+  }
+  else
+  {
+    s_stats.dropped++;
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Message %d dropped, %d delivered, %d retried, %d dropped",
+            purpose, (int)s_stats.delivered, (int)s_stats.retried, (int)s_stats.dropped);
+  }
+  if (s_done)
+  {
+    s_done(purpose, delivered);
+  }
+  send_next();
+}
+
+static void retry_timer_callback(void *data)
+{
+  s_retryTimer = NULL;
+  send_next();
+}
+
+static void retry_head(AppMessageResult reason)
+{
+  s_inFlight = false;
+  s_queue[0].attempts++;
+  if ((reason == APP_MSG_NOT_CONNECTED) || (s_queue[0].attempts >= SEND_QUEUE_MAX_ATTEMPTS))
+  {
+    finish_head(false);
+    return;
+  }
+
+  s_stats.retried++;
+  s_retryTimer = app_timer_register(FIRST_RETRY_MS << (s_queue[0].attempts - 1), retry_timer_callback, NULL);
+}
+
+static void send_next()
+{
+  if (s_inFlight || s_retryTimer || (s_count == 0))
+  {
+    return;
+  }
+
+  DictionaryIterator *iter;
+  AppMessageResult result = app_message_outbox_begin(&iter);
+  if (result == APP_MSG_OK)
+  {
+    s_queue[0].writer(iter);
+    result = app_message_outbox_send();
+  }
+
+  if (result == APP_MSG_OK)
+  {
+    s_inFlight = true;
+  }
+  else
+  {
+    retry_head(result);
+  }
+}
+
+void send_queue_init(SendQueueDone done)
+{
+  s_done = done;
+  s_count = 0;
+  s_inFlight = false;
+  s_retryTimer = NULL;
+  memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void send_queue_deinit(void)
+{
+  if (s_retryTimer)
+  {
+    app_timer_cancel(s_retryTimer);
+    s_retryTimer = NULL;
+  }
+  s_count = 0;
+  s_done = NULL;
+}
+
+bool send_queue_push(uint8_t purpose, uint8_t priority, SendQueueWriter writer)
+{
+  // The head keeps its place once it has been tried.
+  bool headStarted = s_inFlight || s_retryTimer;
+  int firstWaiting = headStarted ? 1 : 0;
+
+  for (int index = firstWaiting; index < s_count; index++)
+  {
+    if (s_queue[index].purpose == purpose)
+    {
+      s_queue[index].writer = writer;
+      return true;
+    }
+  }
+
+  if (s_count == SEND_QUEUE_SIZE)
+  {
+    // Waiting messages are sorted by priority, so the last one is the
+    // least important.
+    int last = s_count - 1;
+    if ((last < firstWaiting) || (s_queue[last].priority >= priority))
+    {
+      s_stats.dropped++;
+      return false;
+    }
+    uint8_t droppedPurpose = s_queue[last].purpose;
+    remove_message(last);
+    s_stats.dropped++;
+    if (s_done)
+    {
+      s_done(droppedPurpose, false);
+    }
+  }
+
+  int index = s_count;
+  while ((index > firstWaiting) && (s_queue[index - 1].priority < priority))
+  {
+    index--;
+  }
+  memmove(&s_queue[index + 1], &s_queue[index], (s_count - index) * sizeof(s_queue[0]));
+  s_queue[index] = (QueuedMessage) {
+    .purpose = purpose,
+    .priority = priority,
+    .attempts = 0,
+    .writer = writer,
+  };
+  s_count++;
+
+  send_next();
+  return true;
+}
+
+void send_queue_outbox_sent(void)
+{
+  if (s_inFlight)
+  {
+    finish_head(true);
+  }
+}
+
+void send_queue_outbox_failed(AppMessageResult reason)
+{
+  if (s_inFlight)
+  {
+    retry_head(reason);
+  }
+}
+
+const SendQueueStats *send_queue_stats(void)
+{
+  return &s_stats;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <pebble.h>
+
+// Outgoing AppMessages, sent one at a time in priority order. Every
+// message has a purpose, which is also what makes two messages the
+// same: queueing a purpose that is already waiting merges into it. The
+// dictionary is only written when the message goes out, so it always
+// carries the latest data.
+//
+// Messages the phone does not acknowledge are retried after 500 ms,
+// doubling each time, up to SEND_QUEUE_MAX_ATTEMPTS sends. Without a
+// Bluetooth connection they are dropped straight away.
+
+#define SEND_QUEUE_SIZE 4
+#define SEND_QUEUE_MAX_ATTEMPTS 3
+
+typedef void (*SendQueueWriter)(DictionaryIterator *iter);
+
+// Called once for every queued message, when it is delivered or given up.
+typedef void (*SendQueueDone)(uint8_t purpose, bool delivered);
+
+typedef struct
+{
+  uint32_t delivered;
+  uint32_t retried;
+  uint32_t dropped;
+} SendQueueStats;
+
+void send_queue_init(SendQueueDone done);
+void send_queue_deinit(void);
+
+// Higher priorities go first. Returns false if the queue is full of
+// messages that matter at least as much; the message is then dropped.
+bool send_queue_push(uint8_t purpose, uint8_t priority, SendQueueWriter writer);
+
+// To be called from the AppMessage outbox sent and failed callbacks.
+void send_queue_outbox_sent(void);
+void send_queue_outbox_failed(AppMessageResult reason);
+
+const SendQueueStats *send_queue_stats(void);
@@ -0,0 +1,53 @@
+#include "snapshot.h"
+
+int snapshot_temperature(const PersistedState *state, time_t now)
+{
+  int estimate_c;
+  if ((now - state->currentObserved > SNAPSHOT_SECONDS_UNTIL_STALE) &&
+      hourly_temperature(&state->hourly, now, &estimate_c))
+  {
+    return estimate_c;
+  }
+  return state->currentTemperature_c;
+}
+
+uint32_t snapshot_refresh_interval(const PersistedState *state, time_t now, const PowerProfile *profile)
+{
+  return hourly_covers(&state->hourly, now, SNAPSHOT_SECONDS_HOURLY_AHEAD) ?
+         profile->coveredInterval_seconds : profile->weatherInterval_seconds;
+}
+
+static void copy_day(ForecastDay *day, const ForecastDay *found)
+{
+  if (found)
+  {
+    *day = *found;
+  }
+  else
+  {
+    memset(day, 0, sizeof(*day));
+  }
+}
+
+void snapshot_prepare(WeatherSnapshot *snapshot, const PersistedState *state, time_t now,
+                      const PowerProfile *profile)
+{
+  memset(snapshot, 0, sizeof(*snapshot));
+  snapshot->version = SNAPSHOT_VERSION;
+  snapshot->temperature_c = snapshot_temperature(state, now);
+  snapshot->stateWrites = state->writeCount;
+  snapshot->day = forecast_local_day(now);
+  // Nothing received yet: due straight away.
+  snapshot->refreshDue = state->currentObserved ?
+                         state->currentObserved + snapshot_refresh_interval(state, now, profile) : 0;
+  copy_day(&snapshot->today, forecast_find(&state->forecast, snapshot->day));
+  copy_day(&snapshot->tomorrow, forecast_find(&state->forecast, snapshot->day + 1));
+}
+
+bool snapshot_current(const WeatherSnapshot *snapshot, const PersistedState *state, time_t now)
+{
+  return (snapshot->version == SNAPSHOT_VERSION) &&
+         (snapshot->stateWrites == state->writeCount) &&
+         (snapshot->day == forecast_local_day(now)) &&
+         (now < snapshot->refreshDue);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "sdk.h"
+#include "forecast.h"
+#include "power.h"
+#include "state.h"
+
+// The weather as the face shows it during one day: the current
+// temperature, today's and tomorrow's forecast, and when the weather
+// should next be fetched. The background worker prepares it from the
+// saved state when the face closes and at midnight until it opens
+// again, so it is ready under STORAGE_KEY_SNAPSHOT when the face
+// launches. A face without a worker prepares its own.
+
+#define SNAPSHOT_VERSION 1
+
+// After an hour the last current temperature received is replaced by
+// the hourly forecast's estimate. While that forecast covers the next
+// 6 hours, the weather is fetched less often, see power.c.
+#define SNAPSHOT_SECONDS_UNTIL_STALE 3600
+#define SNAPSHOT_SECONDS_HOURLY_AHEAD 21600
+
+// AppWorkerMessage types. The face says when it opens and closes; the
+// worker only prepares snapshots while it is closed, and says when it
+// has saved one. The worker starts some time after the face launches
+// it, so it says hello once it listens, and an open face answers that
+// it is open.
+#define WORKER_MESSAGE_SNAPSHOT 1
+#define WORKER_MESSAGE_FACE_OPEN 2
+#define WORKER_MESSAGE_FACE_CLOSED 3
+#define WORKER_MESSAGE_HELLO 4
+
+typedef struct
+{
+  uint16_t version;
+  int16_t temperature_c;
+  uint32_t stateWrites;   // The state's writeCount it was prepared from.
+  int32_t day;            // Local date it was prepared for, in days since the epoch.
+  int32_t refreshDue;     // When the weather should next be fetched.
+  ForecastDay today;      // day is 0 when there is no forecast.
+  ForecastDay tomorrow;
+} WeatherSnapshot;
+
+// The current temperature to show: the last one received while it is
+// fresh, otherwise the hourly forecast's estimate for now, if it has one.
+int snapshot_temperature(const PersistedState *state, time_t now);
+
+// Seconds between weather fetches: longer while the hourly forecast
+// covers the next hours, as it can stand in for the current temperature.
+uint32_t snapshot_refresh_interval(const PersistedState *state, time_t now, const PowerProfile *profile);
+
+void snapshot_prepare(WeatherSnapshot *snapshot, const PersistedState *state, time_t now,
+                      const PowerProfile *profile);
+
+// Whether a snapshot read back from flash can be shown now: prepared
+// from this very state, today, and the weather not due yet. The
+// temperature is the one when it was prepared; the estimate moves on
+// with the clock, so the face works it out again.
+bool snapshot_current(const WeatherSnapshot *snapshot, const PersistedState *state, time_t now);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "sdk.h"
+#include "forecast.h"
+#include "hourly.h"
+
+// Everything the face keeps across launches, stored as one blob. Only
+// the face writes it; the background worker reads the weather in it to
+// prepare the snapshot, see snapshot.h.
+
+#define STORAGE_KEY_STATE 120
+#define STORAGE_KEY_SNAPSHOT 122
+
+// Layout version of the blob stored under STORAGE_KEY_STATE. Bump it
+// when the layout changes, and carry the older one over in main.c.
+#define STATE_VERSION 1
+
+typedef struct
+{
+  uint16_t version;
+  uint16_t writesToday;       // Flash writes of this blob on writeCountDay,
+  int32_t writeCountDay;      // in days since the epoch.
+  uint32_t writeCount;        // Flash writes of this blob ever.
+  int16_t currentTemperature_c;
+  int16_t currentWindDirection_deg;
+  int16_t currentWindSpeed_metersPerSecond;
+  uint8_t temperatureUnits;   // 0 = F, 1 = C
+  uint8_t windSpeedUnits;     // 0 = KNOTS, 1 = MPH, 2 = KPH, 3 = Beaufort
+  uint8_t weekNumberEnabled;  // 0 = FALSE, 1 = TRUE
+  uint8_t mondayFirst;        // 0 = FALSE, 1 = TRUE
+  uint8_t currentConditions;  // WEATHER_CONDITION_* code, see weather.h.
+  ForecastRing forecast;      // Every day the phone has sent, by date.
+  int32_t currentObserved;    // When currentTemperature_c was received.
+  HourlyTimeline hourly;
+} PersistedState;
+
+_Static_assert(sizeof(PersistedState) <= PERSIST_DATA_MAX_LENGTH, "PersistedState does not fit in one persist key");
@@ -0,0 +1,98 @@
+#include "units.h"
+
+// Meters per second to each unit as a fraction: 3600/1852 for knots,
+// 3600/1609.344 for mph and 3.6 for kph, reduced.
+static const struct
+{
+  uint16_t numerator;
+  uint16_t denominator;
+} s_windSpeedFactors[] = {
+  [WINDSPEED_UNITS_KNOTS] = { 900, 463 },
+  [WINDSPEED_UNITS_MPH] = { 3125, 1397 },
+  [WINDSPEED_UNITS_KPH] = { 18, 5 },
+};
+
+// Lowest speed of forces 1 to 12, in tenths of a meter per second.
+static const uint16_t s_beaufortLimits[12] = {
+  3, 16, 34, 55, 80, 108, 139, 172, 208, 245, 285, 327,
+};
+
+// Fixed width rows rather than pointers, so the tables need no
+// relocations. The 8 points are every other one of the 16.
+static const char s_compassPoints[16][4] = {
+  "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE",
+  "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW",
+};
+
+// numerator / denominator to the nearest whole number, halves away
+// from zero. denominator is positive.
+static int32_t divide_rounded(int32_t numerator, int32_t denominator)
+{
+  return (numerator >= 0) ? (2 * numerator + denominator) / (2 * denominator)
+                          : -((-2 * numerator + denominator) / (2 * denominator));
+}
+
+int units_temperature(int temp_celsius, uint8_t units)
+{
+  if (units != TEMPERATURE_UNITS_F)
+  {
+    return temp_celsius;
+  }
+  return divide_rounded(temp_celsius * 9, 5) + 32;
+}
+
+char units_temperature_letter(uint8_t units)
+{
+  return (units == TEMPERATURE_UNITS_F) ? 'F' : 'C';
+}
+
+int units_wind_speed(int windSpeed_metersPerSecond, uint8_t units)
+{
+  if (windSpeed_metersPerSecond < 0)
+  {
+    return 0;
+  }
+  if (units == WINDSPEED_UNITS_BEAUFORT)
+  {
+    return units_beaufort(windSpeed_metersPerSecond);
+  }
+  if (units >= sizeof(s_windSpeedFactors) / sizeof(s_windSpeedFactors[0]))
+  {
+    return windSpeed_metersPerSecond;
+  }
+  return divide_rounded(windSpeed_metersPerSecond * s_windSpeedFactors[units].numerator,
+                        s_windSpeedFactors[units].denominator);
+}
+
+int units_beaufort(int windSpeed_metersPerSecond)
+{
+  int force = 0;
+  while ((force < 12) && (windSpeed_metersPerSecond * 10 >= s_beaufortLimits[force]))
+  {
+    force++;
+  }
+  return force;
+}
+
+// Index of the nearest of the given number of evenly spaced points, north first.
+// Each covers half its width either side, which never falls on a whole
+// degree for 8 or 16 points.
+static int compass_index(int direction_deg, int points)
+{
+  int degrees = direction_deg % 360;
+  if (degrees < 0)
+  {
+    degrees += 360;
+  }
+  return ((2 * points * degrees + 360) / 720) % points;
+}
+
+const char *units_compass8(int direction_deg)
+{
+  return s_compassPoints[2 * compass_index(direction_deg, 8)];
+}
+
+const char *units_compass16(int direction_deg)
+{
+  return s_compassPoints[compass_index(direction_deg, 16)];
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <pebble.h>
+
+// Conversions from the metric values the phone sends to the units the
+// watch shows, in whole numbers only: the watch has no floating point
+// unit. Results are rounded to the nearest whole number.
+
+// Settings, as kept in the persisted state.
+#define TEMPERATURE_UNITS_F 0
+#define TEMPERATURE_UNITS_C 1
+#define WINDSPEED_UNITS_KNOTS 0
+#define WINDSPEED_UNITS_MPH 1
+#define WINDSPEED_UNITS_KPH 2
+#define WINDSPEED_UNITS_BEAUFORT 3
+
+// Anything but TEMPERATURE_UNITS_F is Celsius.
+int units_temperature(int temp_celsius, uint8_t units);
+char units_temperature_letter(uint8_t units);
+
+// Negative speeds count as calm. Unknown units leave meters per second.
+int units_wind_speed(int windSpeed_metersPerSecond, uint8_t units);
+
+// Beaufort force 0 to 12.
+int units_beaufort(int windSpeed_metersPerSecond);
+
+// Nearest of the 8 or 16 compass points to a direction in whole degrees.
+const char *units_compass8(int direction_deg);
+const char *units_compass16(int direction_deg);
@@ -0,0 +1,186 @@
+#include "weather.h"
+
+static uint16_t read_uint16(const uint8_t *data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static uint32_t read_uint32(const uint8_t *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+bool weather_decode(const uint8_t *data, size_t length, WeatherReport *report)
+{
+  if ((length != WEATHER_MESSAGE_SIZE) || (data[0] != WEATHER_PROTOCOL_VERSION))
+  {
+    return false;
+  }
+
+  report->flags = data[1];
+  report->temperature_c = (int16_t)read_uint16(&data[2]);
+  report->windDirection_deg = read_uint16(&data[4]);
+  report->conditionId = read_uint16(&data[6]);
+  report->windSpeed_metersPerSecond = data[8];
+
+  const uint8_t *day = &data[9];
+  for (int dayIndex = 0; dayIndex < WEATHER_FORECAST_DAYS; dayIndex++)
+  {
+    report->days[dayIndex].time = (int32_t)read_uint32(&day[0]);
+    report->days[dayIndex].conditionId = read_uint16(&day[4]);
+    report->days[dayIndex].low_c = (int8_t)day[6];
+    report->days[dayIndex].high_c = (int8_t)day[7];
+    day += WEATHER_DAY_SIZE;
+  }
+
+  const uint8_t *hourly = &data[WEATHER_HOURLY_OFFSET];
+  report->hourly.start = (int32_t)read_uint32(&hourly[0]);
+  report->hourly.first_c = (int8_t)hourly[4];
+  memcpy(report->hourly.steps, &hourly[5], sizeof(report->hourly.steps));
+  return true;
+}
+
+// OpenWeatherMap condition ids, with the text its API returns as
+// weather.main and weather.description. Everything here is const and
+// stays in flash.
+
+typedef enum
+{
+  SUMMARY_THUNDERSTORM,
+  SUMMARY_DRIZZLE,
+  SUMMARY_RAIN,
+  SUMMARY_SNOW,
+  SUMMARY_MIST,
+  SUMMARY_SMOKE,
+  SUMMARY_HAZE,
+  SUMMARY_DUST,
+  SUMMARY_FOG,
+  SUMMARY_SAND,
+  SUMMARY_ASH,
+  SUMMARY_SQUALL,
+  SUMMARY_TORNADO,
+  SUMMARY_CLEAR,
+  SUMMARY_CLOUDS,
+  SUMMARY_EXTREME,
+} WeatherSummary;
+
+static const char *const s_summaries[] = {
+  "Thunderstorm", "Drizzle", "Rain", "Snow", "Mist", "Smoke", "Haze", "Dust",
+  "Fog", "Sand", "Ash", "Squall", "Tornado", "Clear", "Clouds", "Extreme",
+};
+
+typedef struct
+{
+  uint16_t id;
+  uint8_t summary;
+  const char *description;
+} WeatherCondition;
+
+static const WeatherCondition s_conditions[] = {
+  { 200, SUMMARY_THUNDERSTORM, "thunderstorm with light rain" },
+  { 201, SUMMARY_THUNDERSTORM, "thunderstorm with rain" },
+  { 202, SUMMARY_THUNDERSTORM, "thunderstorm with heavy rain" },
+  { 210, SUMMARY_THUNDERSTORM, "light thunderstorm" },
+  { 211, SUMMARY_THUNDERSTORM, "thunderstorm" },
+  { 212, SUMMARY_THUNDERSTORM, "heavy thunderstorm" },
+  { 221, SUMMARY_THUNDERSTORM, "ragged thunderstorm" },
+  { 230, SUMMARY_THUNDERSTORM, "thunderstorm with light drizzle" },
+  { 231, SUMMARY_THUNDERSTORM, "thunderstorm with drizzle" },
+  { 232, SUMMARY_THUNDERSTORM, "thunderstorm with heavy drizzle" },
+  { 300, SUMMARY_DRIZZLE, "light intensity drizzle" },
+  { 301, SUMMARY_DRIZZLE, "drizzle" },
+  { 302, SUMMARY_DRIZZLE, "heavy intensity drizzle" },
+  { 310, SUMMARY_DRIZZLE, "light intensity drizzle rain" },
+  { 311, SUMMARY_DRIZZLE, "drizzle rain" },
+  { 312, SUMMARY_DRIZZLE, "heavy intensity drizzle rain" },
+  { 313, SUMMARY_DRIZZLE, "shower rain and drizzle" },
+  { 314, SUMMARY_DRIZZLE, "heavy shower rain and drizzle" },
+  { 321, SUMMARY_DRIZZLE, "shower drizzle" },
+  { 500, SUMMARY_RAIN, "light rain" },
+  { 501, SUMMARY_RAIN, "moderate rain" },
+  { 502, SUMMARY_RAIN, "heavy intensity rain" },
+  { 503, SUMMARY_RAIN, "very heavy rain" },
+  { 504, SUMMARY_RAIN, "extreme rain" },
+  { 511, SUMMARY_RAIN, "freezing rain" },
+  { 520, SUMMARY_RAIN, "light intensity shower rain" },
+  { 521, SUMMARY_RAIN, "shower rain" },
+  { 522, SUMMARY_RAIN, "heavy intensity shower rain" },
+  { 531, SUMMARY_RAIN, "ragged shower rain" },
+  { 600, SUMMARY_SNOW, "light snow" },
+  { 601, SUMMARY_SNOW, "snow" },
+  { 602, SUMMARY_SNOW, "heavy snow" },
+  { 611, SUMMARY_SNOW, "sleet" },
+  { 612, SUMMARY_SNOW, "shower sleet" },
+  { 615, SUMMARY_SNOW, "light rain and snow" },
+  { 616, SUMMARY_SNOW, "rain and snow" },
+  { 620, SUMMARY_SNOW, "light shower snow" },
+  { 621, SUMMARY_SNOW, "shower snow" },
+  { 622, SUMMARY_SNOW, "heavy shower snow" },
+  { 701, SUMMARY_MIST, "mist" },
+  { 711, SUMMARY_SMOKE, "smoke" },
+  { 721, SUMMARY_HAZE, "haze" },
+  { 731, SUMMARY_DUST, "sand, dust whirls" },
+  { 741, SUMMARY_FOG, "fog" },
+  { 751, SUMMARY_SAND, "sand" },
+  { 761, SUMMARY_DUST, "dust" },
+  { 762, SUMMARY_ASH, "volcanic ash" },
+  { 771, SUMMARY_SQUALL, "squalls" },
+  { 781, SUMMARY_TORNADO, "tornado" },
+  { 800, SUMMARY_CLEAR, "clear sky" },
+  { 801, SUMMARY_CLOUDS, "few clouds" },
+  { 802, SUMMARY_CLOUDS, "scattered clouds" },
+  { 803, SUMMARY_CLOUDS, "broken clouds" },
+  { 804, SUMMARY_CLOUDS, "overcast clouds" },
+  { 900, SUMMARY_EXTREME, "tornado" },
+  { 901, SUMMARY_EXTREME, "tropical storm" },
+  { 902, SUMMARY_EXTREME, "hurricane" },
+  { 903, SUMMARY_EXTREME, "cold" },
+  { 904, SUMMARY_EXTREME, "hot" },
+  { 905, SUMMARY_EXTREME, "windy" },
+  { 906, SUMMARY_EXTREME, "hail" },
+};
+
+#define CONDITION_COUNT (sizeof(s_conditions) / sizeof(s_conditions[0]))
+
+uint8_t weather_condition_code(uint16_t conditionId)
+{
+  // The table is sorted by id. Codes are the table index plus one, so
+  // that WEATHER_CONDITION_UNKNOWN is 0.
+  int low = 0;
+  int high = CONDITION_COUNT - 1;
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+    if (s_conditions[middle].id == conditionId)
+    {
+      return middle + 1;
+    }
+    if (s_conditions[middle].id < conditionId)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle - 1;
+    }
+  }
+  return WEATHER_CONDITION_UNKNOWN;
+}
+
+const char *weather_description(uint8_t code)
+{
+  if ((code == WEATHER_CONDITION_UNKNOWN) || (code > CONDITION_COUNT))
+  {
+    return "";
+  }
+  return s_conditions[code - 1].description;
+}
+
+const char *weather_summary(uint8_t code)
+{
+  if ((code == WEATHER_CONDITION_UNKNOWN) || (code > CONDITION_COUNT))
+  {
+    return "";
+  }
+  return s_summaries[s_conditions[code - 1].summary];
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <pebble.h>
+#include "hourly.h"
+
+// Weather message sent by weatherStream.js as one byte array under
+// KEY_WEATHER. All values are little-endian and the layout is fixed, so
+// the inbox can be sized to exactly one message.
+//
+//   offset  size  field
+//   0       1     WEATHER_PROTOCOL_VERSION
+//   1       1     WEATHER_HAS_* flags for the parts that were fetched
+//   2       2     current temperature, degrees C, signed
+//   4       2     current wind direction, degrees
+//   6       2     current OpenWeatherMap condition id
+//   8       1     current wind speed, m/s
+//   9       8     forecast day 1, then days 2 to WEATHER_FORECAST_DAYS:
+//                   +0  4  time of the forecast, seconds since the epoch,
+//                          0 if the phone has no forecast for that day
+//                   +4  2  OpenWeatherMap condition id
+//                   +6  1  low, degrees C, signed
+//                   +7  1  high, degrees C, signed
+//   65      52    hourly forecast, see hourly.h:
+//                   +0  4  time of the first hour, seconds since the epoch
+//                   +4  1  temperature at the first hour, degrees C, signed
+//                   +5  47 change to each next hour, degrees C, signed
+
+#define WEATHER_PROTOCOL_VERSION 3
+#define WEATHER_FORECAST_DAYS 7
+#define WEATHER_DAY_SIZE 8
+#define WEATHER_HOURLY_OFFSET (9 + WEATHER_FORECAST_DAYS * WEATHER_DAY_SIZE)
+#define WEATHER_MESSAGE_SIZE (WEATHER_HOURLY_OFFSET + HOURLY_SIZE)
+
+#define WEATHER_HAS_CURRENT (1 << 0)
+#define WEATHER_HAS_FORECAST (1 << 1)
+#define WEATHER_HAS_HOURLY (1 << 2)
+
+typedef struct
+{
+  int32_t time;
+  uint16_t conditionId;
+  int8_t low_c;
+  int8_t high_c;
+} WeatherDay;
+
+typedef struct
+{
+  uint8_t flags;
+  int16_t temperature_c;
+  uint16_t windDirection_deg;
+  uint16_t conditionId;
+  uint8_t windSpeed_metersPerSecond;
+  WeatherDay days[WEATHER_FORECAST_DAYS];
+  HourlyTimeline hourly;
+} WeatherReport;
+
+// Returns false if the message is not a complete message of this version.
+bool weather_decode(const uint8_t *data, size_t length, WeatherReport *report);
+
+// Conditions are kept as a one byte code: the OpenWeatherMap condition
+// id interned into a read-only table that also holds the display text.
+#define WEATHER_CONDITION_UNKNOWN 0
+
+uint8_t weather_condition_code(uint16_t conditionId);
+
+// Display text for a condition code: the full description ("light
+// rain") and the one word summary ("Rain"). Unknown codes show as "".
+const char *weather_description(uint8_t code);
+const char *weather_summary(uint8_t code);
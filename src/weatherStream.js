@@ -3,181 +3,445 @@ var xhrRequest = function (url, type, callback) {
   xhr.onload = function () {
     callback(this.responseText);
   };
+  xhr.onerror = function () {
+    callback(null);
+  };
   xhr.open(type, url);
   xhr.send();
 };
 
-function locationSuccess(pos) {
-  // Construct URL
-  var url = "http://api.openweathermap.org/data/2.5/weather?lat=" +
-      pos.coords.latitude + "&lon=" + pos.coords.longitude;
+// Weather message layout, see src/weather.h. Everything the watch shows
+// goes out as one little-endian byte array under KEY_WEATHER.
+var WEATHER_PROTOCOL_VERSION = 3;
+var WEATHER_FORECAST_DAYS = 7;
+var WEATHER_HOURLY_HOURS = 48;
+var WEATHER_HAS_CURRENT = 1;
+var WEATHER_HAS_FORECAST = 2;
+var WEATHER_HAS_HOURLY = 4;
+
+function pushUint8(bytes, value) {
+  bytes.push(value & 0xFF);
+}
+
+function pushUint16(bytes, value) {
+  bytes.push(value & 0xFF, (value >> 8) & 0xFF);
+}
+
+function pushUint32(bytes, value) {
+  pushUint16(bytes, value & 0xFFFF);
+  pushUint16(bytes, (value >>> 16) & 0xFFFF);
+}
+
+function encodeWeather(current, forecast, hourly) {
+  var flags = (current ? WEATHER_HAS_CURRENT : 0) | (forecast ? WEATHER_HAS_FORECAST : 0) |
+              (hourly ? WEATHER_HAS_HOURLY : 0);
+  current = current || { temperature: 0, windDirection: 0, conditionId: 0, windSpeed: 0 };
+
+  var bytes = [];
+  pushUint8(bytes, WEATHER_PROTOCOL_VERSION);
+  pushUint8(bytes, flags);
+  pushUint16(bytes, current.temperature);
+  pushUint16(bytes, current.windDirection);
+  pushUint16(bytes, current.conditionId);
+  pushUint8(bytes, Math.min(current.windSpeed, 255));
+  // The watch keeps every day it is sent, by date; days the forecast
+  // doesn't cover go out with time 0 and are skipped.
+  for (var i = 0; i < WEATHER_FORECAST_DAYS; i++) {
+    var day = (forecast && forecast[i]) || { time: 0, conditionId: 0, min: 0, max: 0 };
+    pushUint32(bytes, day.time);
+    pushUint16(bytes, day.conditionId);
+    pushUint8(bytes, day.min);
+    pushUint8(bytes, day.max);
+  }
+  // The hourly temperatures go out as the first one followed by the
+  // change from each hour to the next; hours past the end of the
+  // forecast repeat its last temperature.
+  hourly = hourly || { time: 0, temperatures: [0] };
+  pushUint32(bytes, hourly.time);
+  pushUint8(bytes, hourly.temperatures[0]);
+  for (var h = 1; h < WEATHER_HOURLY_HOURS; h++) {
+    var step = h < hourly.temperatures.length ? hourly.temperatures[h] - hourly.temperatures[h - 1] : 0;
+    pushUint8(bytes, Math.max(-128, Math.min(step, 127)));
+  }
+  return bytes;
+}
+
+function parseJson(responseText) {
+  try {
+    return responseText ? JSON.parse(responseText) : null;
+  } catch (e) {
+    return null;
+  }
+}
+
+// Messages to the watch go out one at a time, highest priority first.
+// Queueing a purpose that is already waiting replaces its dictionary,
+// so the watch only gets the latest weather or configuration. Messages
+// the watch does not acknowledge are retried after 1 s, doubling, up to
+// SEND_MAX_ATTEMPTS sends.
+var SEND_QUEUE_SIZE = 4;
+var SEND_MAX_ATTEMPTS = 3;
+var SEND_FIRST_RETRY_MS = 1000;
+var SEND_PRIORITY = { config: 2, weather: 1, counters: 0 };
+
+var sendQueue = [];
+var sendInFlight = false;
+var sendStats = { delivered: 0, retried: 0, dropped: 0 };
+
+function countSend(result, purpose) {
+  sendStats[result]++;
+  console.log("AppMessage " + purpose + " " + result + " (" + sendStats.delivered + " delivered, " +
+              sendStats.retried + " retried, " + sendStats.dropped + " dropped)");
+}
+
+function sendNext() {
+  if (sendInFlight || sendQueue.length === 0) {
+    return;
+  }
+
+  // The head stays in the queue, and in place, until it is delivered or
+  // given up.
+  var message = sendQueue[0];
+  sendInFlight = true;
+  Pebble.sendAppMessage(message.dictionary,
+    function(e) {
+      sendQueue.shift();
+      sendInFlight = false;
+      countSend("delivered", message.purpose);
+      sendNext();
+    },
+    function(e) {
+      message.attempts++;
+      if (message.attempts >= SEND_MAX_ATTEMPTS) {
+        sendQueue.shift();
+        sendInFlight = false;
+        countSend("dropped", message.purpose);
+        sendNext();
+        return;
+      }
+      countSend("retried", message.purpose);
+      setTimeout(function() {
+        sendInFlight = false;
+        sendNext();
+      }, SEND_FIRST_RETRY_MS << (message.attempts - 1));
+    }
+  );
+}
+
+function queueAppMessage(purpose, dictionary) {
+  var firstWaiting = sendInFlight ? 1 : 0;
+  for (var i = firstWaiting; i < sendQueue.length; i++) {
+    if (sendQueue[i].purpose === purpose) {
+      sendQueue[i].dictionary = dictionary;
+      return;
+    }
+  }
+
+  var message = { purpose: purpose, dictionary: dictionary, priority: SEND_PRIORITY[purpose], attempts: 0 };
+  if (sendQueue.length >= SEND_QUEUE_SIZE) {
+    // Waiting messages are sorted by priority; make room by dropping the
+    // least important one, unless the new one matters even less.
+    var last = sendQueue[sendQueue.length - 1];
+    if (sendQueue.length - 1 < firstWaiting || last.priority >= message.priority) {
+      countSend("dropped", purpose);
+      return;
+    }
+    sendQueue.pop();
+    countSend("dropped", last.purpose);
+  }
+
+  var index = sendQueue.length;
+  while (index > firstWaiting && sendQueue[index - 1].priority < message.priority) {
+    index--;
+  }
+  sendQueue.splice(index, 0, message);
+  sendNext();
+}
+
+function sendWeather(weather) {
+  queueAppMessage("weather", { "KEY_WEATHER": weather });
+}
+
+// The weather is kept in localStorage in parts, each with when it was
+// fetched, along with the location it was fetched for. Within
+// WEATHER_CACHE_TTL_MINUTES of the current weather the watch is sent
+// the cached parts as they are, without any network requests. The watch
+// asks for new weather 30 minutes to 6 hours apart, depending on its
+// power profile (see src/power.c), so those requests always find the
+// current weather expired and fetch it. The forecasts change far more slowly
+// than the current weather, and are only fetched again once they are
+// WEATHER_FORECAST_TTL_MINUTES old.
+var WEATHER_CACHE_TTL_MINUTES = 25;
+var WEATHER_FORECAST_TTL_MINUTES = 180;
+var WEATHER_CACHE_KEY = "weatherParts";
+var WEATHER_CACHE_STATS_KEY = "weatherCacheStats";
+var WEATHER_PARTS = ["current", "forecast", "hourly"];
+
+function weatherCacheKey(location) {
+  return location.lat.toFixed(LOCATION_GRID_DECIMALS) + "," + location.lon.toFixed(LOCATION_GRID_DECIMALS);
+}
+
+function readJson(storageKey) {
+  return parseJson(localStorage.getItem(storageKey));
+}
+
+// Counts survive the JS being restarted with the watch face.
+function countCacheLookup(result) {
+  var stats = readJson(WEATHER_CACHE_STATS_KEY) || { hit: 0, stale: 0, miss: 0 };
+  stats[result]++;
+  localStorage.setItem(WEATHER_CACHE_STATS_KEY, JSON.stringify(stats));
+  console.log("Weather cache " + result + " (" + stats.hit + " hits, " +
+              stats.stale + " stale, " + stats.miss + " misses)");
+}
+
+function partAge(cached, part) {
+  return cached[part] ? Date.now() - cached[part].fetched : Infinity;
+}
+
+function encodeCached(cached) {
+  return encodeWeather(cached.current && cached.current.value, cached.forecast && cached.forecast.value,
+                       cached.hourly && cached.hourly.value);
+}
+
+function lookUpWeather(location, watchHasWeather) {
+  var key = weatherCacheKey(location);
+  var cached = readJson(WEATHER_CACHE_KEY);
+  if (cached && cached.key === key) {
+    if (partAge(cached, "current") < WEATHER_CACHE_TTL_MINUTES * 60 * 1000) {
+      countCacheLookup("hit");
+      sendWeather(encodeCached(cached));
+      return;
+    }
+
+    // Stale: a watch with nothing to show gets the old weather at once
+    // while the new one is fetched.
+    countCacheLookup("stale");
+    if (!watchHasWeather) {
+      sendWeather(encodeCached(cached));
+    }
+  } else {
+    countCacheLookup("miss");
+    cached = { key: key };
+  }
+
+  var due = WEATHER_PARTS.filter(function(part) {
+    return part === "current" || partAge(cached, part) >= WEATHER_FORECAST_TTL_MINUTES * 60 * 1000;
+  });
+  fetchWeather(location, due, function(weather) {
+    due.forEach(function(part) {
+      if (weather[part]) {
+        cached[part] = { fetched: Date.now(), value: weather[part] };
+      }
+    });
+    localStorage.setItem(WEATHER_CACHE_KEY, JSON.stringify(cached));
+    sendWeather(encodeCached(cached));
+  });
+}
+
+// The parts of a One Call response the watch uses, as a record of plain
+// numbers: { current: { temperature, windSpeed, windDirection,
+// conditionId }, forecast: [{ time, conditionId, min, max }],
+// hourly: { time, temperatures: [] } }. Temperatures are whole degrees
+// C and speeds whole m/s. A part that is missing or malformed is null.
+function isNumber(value) {
+  return typeof value === "number" && isFinite(value);
+}
+
+function conditionIdOf(entry) {
+  return (entry.weather && entry.weather[0] && isNumber(entry.weather[0].id)) ? entry.weather[0].id : 0;
+}
+
+function extractCurrent(current) {
+  if (!current || !isNumber(current.temp) || !isNumber(current.wind_speed)) {
+    return null;
+  }
+  return {
+    temperature: Math.round(current.temp),
+    windSpeed: Math.round(current.wind_speed),
+    windDirection: Math.round(current.wind_deg || 0),
+    // The watch turns the condition id into its description.
+    conditionId: conditionIdOf(current)
+  };
+}
 
-  // Send request to OpenWeatherMap
-  xhrRequest(url, 'GET', 
+function extractForecast(daily) {
+  if (!daily || daily.length === 0) {
+    return null;
+  }
+  var forecast = [];
+  for (var i = 0; i < Math.min(daily.length, WEATHER_FORECAST_DAYS); i++) {
+    var day = daily[i];
+    if (!isNumber(day.dt) || !day.temp || !isNumber(day.temp.min) || !isNumber(day.temp.max)) {
+      return null;
+    }
+    forecast.push({
+      time: day.dt,
+      conditionId: conditionIdOf(day),
+      min: Math.round(day.temp.min),
+      max: Math.round(day.temp.max)
+    });
+  }
+  return forecast;
+}
+
+function extractHourly(hours) {
+  // The watch interpolates between hours, so it needs at least two.
+  if (!hours || hours.length < 2 || !isNumber(hours[0].dt)) {
+    return null;
+  }
+  var hourly = { time: hours[0].dt, temperatures: [] };
+  for (var i = 0; i < Math.min(hours.length, WEATHER_HOURLY_HOURS); i++) {
+    if (!isNumber(hours[i].temp)) {
+      return null;
+    }
+    hourly.temperatures.push(Math.round(hours[i].temp));
+  }
+  return hourly;
+}
+
+// Fetch the parts of the weather named in due for location, with one
+// One Call request in metric units that excludes everything else.
+// callback gets the record above if any of them came back.
+var ONE_CALL_BLOCKS = { current: "current", forecast: "daily", hourly: "hourly" };
+
+function fetchWeather(location, due, callback) {
+  var excluded = ["minutely", "alerts"];
+  WEATHER_PARTS.forEach(function(part) {
+    if (due.indexOf(part) < 0) {
+      excluded.push(ONE_CALL_BLOCKS[part]);
+    }
+  });
+  var url = "http://api.openweathermap.org/data/2.5/onecall?lat=" + location.lat + "&lon=" + location.lon +
+      "&units=metric&exclude=" + excluded.join(",");
+
+  xhrRequest(url, 'GET',
     function(responseText) {
-      // responseText contains a JSON object with weather info
-      var json = JSON.parse(responseText);
-
-      // Temperature in Kelvin requires adjustment
-      var temperature = Math.round(json.main.temp - 273.15);
-      //console.log("WX Temperature is " + temperature);
-
-      // Conditions
-      //var conditions = json.weather[0].main;      
-      //console.log("WX Conditions are " + conditions);
-      
-      // Temperature Min
-      //var temperatureMin = Math.round(json.main.temp_min - 273.15);
-      //console.log("WX Min Temperature is " + temperatureMin);
-      
-      // Temperature Min
-      //var temperatureMax = Math.round(json.main.temp_max - 273.15);
-      //console.log("WX Max Temperature is " + temperatureMax);
-      
-      // Wind Speed
-      var windSpeed = Math.round(json.wind.speed);
-      //console.log("WX Wind Speed is " + windSpeed);
-      
-      // Wind Direction
-      var windDirection = Math.round(json.wind.deg);
-      //console.log("WX Wind Direction is " + windDirection);
-      
-      // Humidity
-      //var humidity = Math.round(json.main.humidity);
-      //console.log("WX Humidity is " + humidity);
-      
-      // Description
-      var description = json.weather[0].description;      
-      //console.log("WX Description is " + description);
-      
-      // Assemble dictionary using our keys
-      var dictionary = {
-        "KEY_TEMPERATURE": temperature,
-        "KEY_WIND_SPEED": windSpeed,
-        "KEY_WIND_DIRECTION": windDirection,
-        "KEY_DESCRIPTION": description
+      var json = parseJson(responseText);
+      if (!json) {
+        return;
+      }
+      var weather = {
+        current: extractCurrent(json.current),
+        forecast: extractForecast(json.daily),
+        hourly: extractHourly(json.hourly)
       };
-//        "KEY_TEMP_MIN": temperatureMin,
-//        "KEY_TEMP_MAX": temperatureMax,
-//        "KEY_CONDITIONS": conditions,
-//        "KEY_HUMIDITY": humidity,
-
-      // Send to Pebble
-      Pebble.sendAppMessage(dictionary,
-        function(e) {
-          //console.log("Weather info sent to Pebble successfully WX!");
-        },
-        function(e) {
-          //console.log("Error sending weather info to Pebble WX!");
-        }
-      );
-    }      
+      if (weather.current || weather.forecast || weather.hourly) {
+        callback(weather);
+      }
+    }
   );
-  
-  // Construct URL
-  var forecasturl = "http://api.openweathermap.org/data/2.5/forecast/daily?lat=" +
-      pos.coords.latitude + "&lon=" + pos.coords.longitude;
-
-  // Send request to OpenWeatherMap
-  xhrRequest(forecasturl, 'GET', 
-    function(responseForecastText) {
-      // responseText contains a JSON object with weather info
-      var json = JSON.parse(responseForecastText);
-
-      var day1Time = json.list[0].dt;
-      //console.log("Day 1 Time is " + day1Time);
-      
-      // Conditions
-      var day1Conditions = json.list[0].weather[0].main;      
-      //console.log("Day 1 Forecast is " + day1Conditions);
-      
-      // Temperature in Kelvin requires adjustment
-      var day1TemperatureMin = Math.round(json.list[0].temp.min - 273.15);
-      //console.log("Day 1 Min Temperature is " + day1TemperatureMin);
-
-      // Temperature in Kelvin requires adjustment
-      var day1TemperatureMax = Math.round(json.list[0].temp.max - 273.15);
-      //console.log("Day 1 Max Temperature is " + day1TemperatureMax);
-
-      var day2Time = json.list[1].dt;
-      //console.log("Day 2 Time is " + day2Time);
-      
-      // Conditions
-      var day2Conditions = json.list[1].weather[0].main;      
-      //console.log("Day 2 Forecast is " + day2Conditions);
-           
-      // Temperature in Kelvin requires adjustment
-      var day2TemperatureMin = Math.round(json.list[1].temp.min - 273.15);
-      //console.log("Day 2 Min Temperature is " + day2TemperatureMin);
-
-      // Temperature in Kelvin requires adjustment
-      var day2TemperatureMax = Math.round(json.list[1].temp.max - 273.15);
-      //console.log("Day 2 Max Temperature is " + day2TemperatureMax);
-
-      var day3Time = json.list[2].dt;
-      //console.log("Day 3 Time is " + day3Time);
-      
-      // Conditions
-      var day3Conditions = json.list[2].weather[0].main;      
-      //console.log("Day 3 Forecast is " + day3Conditions);
-           
-      // Temperature in Kelvin requires adjustment
-      var day3TemperatureMin = Math.round(json.list[2].temp.min - 273.15);
-      //console.log("Day 3 Min Temperature is " + day3TemperatureMin);
-
-      // Temperature in Kelvin requires adjustment
-      var day3TemperatureMax = Math.round(json.list[2].temp.max - 273.15);
-      //console.log("Day 3 Max Temperature is " + day3TemperatureMax);
-
-      // Assemble dictionary using our keys
-      var dictionary = {
-        "KEY_DAY1_TIME": day1Time,
-        "KEY_DAY1_CONDITIONS": day1Conditions,
-        "KEY_DAY1_TEMP_MIN": day1TemperatureMin,
-        "KEY_DAY1_TEMP_MAX": day1TemperatureMax,
-        "KEY_DAY2_TIME": day2Time,
-        "KEY_DAY2_CONDITIONS": day2Conditions,
-        "KEY_DAY2_TEMP_MIN": day2TemperatureMin,
-        "KEY_DAY2_TEMP_MAX": day2TemperatureMax,
-        "KEY_DAY3_TIME": day3Time,
-        "KEY_DAY3_CONDITIONS": day3Conditions,
-        "KEY_DAY3_TEMP_MIN": day3TemperatureMin,
-        "KEY_DAY3_TEMP_MAX": day3TemperatureMax
-      };
+}
 
-      // Send to Pebble
-      Pebble.sendAppMessage(dictionary,
-        function(e) {
-          //console.log("Weather info sent to Pebble successfully WX!");
-        },
-        function(e) {
-          //console.log("Error sending weather info to Pebble WX!");
-        }
-      );
-    }      
-  );
-  
+// Weather does not change over a few hundred metres, so positions are
+// snapped to a 0.01 degree grid (about 1 km) before they are used. That
+// keeps the weather cache key and the request URLs stable, and tells
+// OpenWeatherMap no more than it needs to know.
+var LOCATION_GRID_DECIMALS = 2;
+
+// The last location is reused without asking for a fix for
+// LOCATION_REUSE_MINUTES, which is longer than the 6 hours the watch
+// waits at most between weather requests (see src/power.c), so a fix is
+// asked for at most every other request. After that a coarse fix is
+// requested, which the phone may answer from its own recent fix or the
+// network instead of the GPS. The stored location only moves when that
+// fix is more than LOCATION_MOVE_METERS away.
+var LOCATION_REUSE_MINUTES = 7 * 60;
+var LOCATION_MOVE_METERS = 1000;
+var LOCATION_KEY = "location";
+
+function quantize(degrees) {
+  var scale = Math.pow(10, LOCATION_GRID_DECIMALS);
+  return Math.round(degrees * scale) / scale;
 }
 
-function locationError(err) {
-  console.log("Error requesting location WX!");
+// Equirectangular approximation, plenty for distances of a few km.
+function distanceMeters(lat1, lon1, lat2, lon2) {
+  var radians = Math.PI / 180;
+  var x = (lon2 - lon1) * radians * Math.cos((lat1 + lat2) / 2 * radians);
+  var y = (lat2 - lat1) * radians;
+  return Math.sqrt(x * x + y * y) * 6371000;
 }
 
-function getWeather() {
+function getLocation(callback) {
+  var cached = readJson(LOCATION_KEY);
+  if (cached && Date.now() - cached.time < LOCATION_REUSE_MINUTES * 60 * 1000) {
+    callback(cached);
+    return;
+  }
+
   navigator.geolocation.getCurrentPosition(
-    locationSuccess,
-    locationError,
-    {timeout: 15000, maximumAge: 60000}
+    function(pos) {
+      var lat = pos.coords.latitude;
+      var lon = pos.coords.longitude;
+      var location;
+      if (cached && distanceMeters(cached.fixLat, cached.fixLon, lat, lon) < LOCATION_MOVE_METERS) {
+        // Not moved: keep the same grid point so the weather cache hits.
+        location = cached;
+      } else {
+        location = { lat: quantize(lat), lon: quantize(lon), fixLat: lat, fixLon: lon };
+      }
+      location.time = Date.now();
+      localStorage.setItem(LOCATION_KEY, JSON.stringify(location));
+      callback(location);
+    },
+    function(err) {
+      console.log("Error requesting location WX!");
+      // An old location still gives better weather than none.
+      if (cached) {
+        callback(cached);
+      }
+    },
+    {enableHighAccuracy: false, timeout: 15000, maximumAge: LOCATION_REUSE_MINUTES * 60 * 1000}
   );
 }
 
-// Listen for when the watchface is opened
+// The watch keeps counters of what it does (see src/counters.h) and
+// sends them when asked, at most once every COUNTERS_INTERVAL_HOURS.
+// The last ones received are kept in localStorage, logged and passed to
+// the configuration page.
+var COUNTERS_INTERVAL_HOURS = 24;
+var COUNTERS_KEY = "counters";
+var COUNTER_NAMES = [
+  "launches", "secondTicks", "minuteTicks", "textUpdates", "inboxMessages", "inboxBytes",
+  "inboxDropped", "outboxSent", "outboxFailed", "persistWrites", "secondsShown"
+];
+
+function requestCounters() {
+  var counters = readJson(COUNTERS_KEY);
+  if (counters && Date.now() - counters.time < COUNTERS_INTERVAL_HOURS * 60 * 60 * 1000) {
+    return;
+  }
+  queueAppMessage("counters", { "KEY_REQUEST_COUNTERS": 1 });
+}
+
+function readUint32(bytes, offset) {
+  return (bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (bytes[offset + 3] << 24)) >>> 0;
+}
+
+function receiveCounters(bytes) {
+  // Counters this script doesn't know by name yet are kept by index.
+  var counters = { time: Date.now(), version: bytes[0] };
+  for (var i = 0; i < bytes[1] && 2 + 4 * i + 4 <= bytes.length; i++) {
+    counters[COUNTER_NAMES[i] || "counter" + i] = readUint32(bytes, 2 + 4 * i);
+  }
+  localStorage.setItem(COUNTERS_KEY, JSON.stringify(counters));
+  console.log("Watch counters: " + JSON.stringify(counters));
+}
+
+// watchHasWeather is false when the watch has nothing to show yet and
+// should be sent something straight away.
+function getWeather(watchHasWeather) {
+  getLocation(function(location) {
+    lookUpWeather(location, watchHasWeather);
+  });
+}
+
+// Listen for when the watchface is opened. The watch shows the weather
+// it saved and asks for new weather itself once it is due.
 Pebble.addEventListener('ready', 
   function(e) {
     //console.log("PebbleKit WX JS ready!");
-
-    // Get the initial weather
-    getWeather();
+    requestCounters();
   }
 );
 
@@ -185,39 +449,55 @@ Pebble.addEventListener('ready',
 Pebble.addEventListener('appmessage',
   function(e) {
     //console.log("AppMessage WX received!");
-    getWeather();
+    if (e.payload.KEY_COUNTERS) {
+      receiveCounters(e.payload.KEY_COUNTERS);
+      return;
+    }
+    // KEY_REQUEST_WEATHER is 1 while the watch has nothing to show.
+    getWeather(e.payload.KEY_REQUEST_WEATHER !== 1);
   }                     
 );
 
 Pebble.addEventListener("showConfiguration",
   function(e) {
-    Pebble.openURL("http://clintka.github.io/AllInfoAsText/index.html");
+    var counters = localStorage.getItem(COUNTERS_KEY);
+    Pebble.openURL("http://clintka.github.io/AllInfoAsText/index.html" +
+                   (counters ? "?counters=" + encodeURIComponent(counters) : ""));
   }
 );
 
-Pebble.addEventListener("webviewclosed",
-  function(e) {
-    //Get JSON dictionary
-    var configuration = JSON.parse(decodeURIComponent(e.response));
-    //console.log("Configuration window returned: " + JSON.stringify(configuration));
- 
-    // Assemble dictionary using our keys
-    var dictionary = {
-      "CONFIG_KEY_TEMPERATURE_UNITS": configuration.temperatureUnits,
-      "CONFIG_KEY_WINDSPEED_UNITS": configuration.windspeedUnits,
-      "CONFIG_KEY_WEEKNUMBER_ENABLED": configuration.weekNumberEnabled,
-      "CONFIG_KEY_MONDAY_FIRST": configuration.mondayFirst
-      };
+// Configuration message, see src/config.h. Every setting goes out as
+// the integer the watch stores, with the schema version; the watch
+// ignores a message it doesn't understand as a whole. The settings page
+// returns names, which are looked up here, or already the integers.
+var CONFIG_SCHEMA_VERSION = 1;
+var CONFIG_SETTINGS = [
+  { key: "CONFIG_KEY_TEMPERATURE_UNITS", field: "temperatureUnits", values: ["F", "C"] },
+  { key: "CONFIG_KEY_WINDSPEED_UNITS", field: "windspeedUnits", values: ["KNOTS", "MPH", "KPH", "BEAUFORT"] },
+  { key: "CONFIG_KEY_WEEKNUMBER_ENABLED", field: "weekNumberEnabled", values: ["DISABLED", "ENABLED"] },
+  { key: "CONFIG_KEY_MONDAY_FIRST", field: "mondayFirst", values: ["DISABLED", "ENABLED"] }
+];
 
-      // Send to Pebble
-      Pebble.sendAppMessage(dictionary,
-        function(e) {
-          //console.log("Config info sent to Pebble successfully!");
-        },
-        function(e) {
-          //console.log("Error sending config info to Pebble!");
-        }
-      );
+function encodeConfig(configuration) {
+  var dictionary = { "CONFIG_KEY_VERSION": CONFIG_SCHEMA_VERSION };
+  CONFIG_SETTINGS.forEach(function(setting) {
+    var value = configuration[setting.field];
+    var index = typeof value === "number" ? value : setting.values.indexOf(value);
+    // Settings the page didn't return, or returned as something unknown,
+    // are left as the watch has them.
+    if (index >= 0 && index < setting.values.length && index === Math.floor(index)) {
+      dictionary[setting.key] = index;
+    }
+  });
+  return dictionary;
+}
 
+Pebble.addEventListener("webviewclosed",
+  function(e) {
+    var configuration = parseJson(e.response && decodeURIComponent(e.response));
+    if (!configuration) {
+      return;
+    }
+    queueAppMessage("config", encodeConfig(configuration));
   }
 );
@@ -0,0 +1,101 @@
+#include <pebble_worker.h>
+#include "../src/power.h"
+#include "../src/snapshot.h"
+#include "../src/state.h"
+
+// Background worker. Only the face can talk to the phone, so the worker
+// doesn't fetch anything. It keeps what the face will show current
+// while the face isn't running: when the face closes, and then at
+// midnight, it prepares the weather snapshot from the state the face
+// saved, along with when the weather is next due, and saves it only if
+// any of that changed. A face that launches then only has to read the
+// snapshot. While the face is open it keeps its own weather, and the
+// worker only waits.
+
+static bool s_faceOpen;
+static PowerProfileId s_powerProfile = POWER_NORMAL;
+static WeatherSnapshot s_savedSnapshot; // What flash holds, so an unchanged snapshot is never rewritten.
+
+static void prepare_snapshot()
+{
+  PersistedState state;
+  if ((persist_get_size(STORAGE_KEY_STATE) != sizeof(state)) ||
+      (persist_read_data(STORAGE_KEY_STATE, &state, sizeof(state)) != sizeof(state)) ||
+      (state.version != STATE_VERSION))
+  {
+    // Nothing saved yet, or a layout the face hasn't upgraded yet.
+    return;
+  }
+
+  // Chosen as the face chooses its own, so both agree on when the
+  // weather is due.
+  s_powerProfile = power_profile_select(s_powerProfile, battery_state_service_peek());
+
+  WeatherSnapshot snapshot;
+  snapshot_prepare(&snapshot, &state, time(NULL), power_profile(s_powerProfile));
+  if (memcmp(&snapshot, &s_savedSnapshot, sizeof(snapshot)) == 0)
+  {
+    return;
+  }
+  persist_write_data(STORAGE_KEY_SNAPSHOT, &snapshot, sizeof(snapshot));
+  s_savedSnapshot = snapshot;
+
+  // A face that opened meanwhile picks it up.
+  AppWorkerMessage message = { 0 };
+  app_worker_send_message(WORKER_MESSAGE_SNAPSHOT, &message);
+}
+
+static void message_handler(uint16_t type, AppWorkerMessage *data)
+{
+  if (type == WORKER_MESSAGE_FACE_OPEN)
+  {
+    s_faceOpen = true;
+  }
+  else if (type == WORKER_MESSAGE_FACE_CLOSED)
+  {
+    // The face saved its state on the way out.
+    s_faceOpen = false;
+    prepare_snapshot();
+  }
+}
+
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed)
+{
+  if (!s_faceOpen)
+  {
+    prepare_snapshot();
+  }
+}
+
+static void init(void)
+{
+  if (persist_read_data(STORAGE_KEY_SNAPSHOT, &s_savedSnapshot, sizeof(s_savedSnapshot)) != sizeof(s_savedSnapshot))
+  {
+    memset(&s_savedSnapshot, 0, sizeof(s_savedSnapshot));
+  }
+
+  // Launched by the face, or when the watch starts. Whatever the face
+  // sent before now is lost, so it is asked again.
+  s_faceOpen = false;
+  prepare_snapshot();
+
+  app_worker_message_subscribe(message_handler);
+  tick_timer_service_subscribe(DAY_UNIT, tick_handler);
+
+  AppWorkerMessage message = { 0 };
+  app_worker_send_message(WORKER_MESSAGE_HELLO, &message);
+}
+
+static void deinit(void)
+{
+  tick_timer_service_unsubscribe();
+  app_worker_message_unsubscribe();
+}
+
+int main(void)
+{
+  init();
+  worker_event_loop();
+  deinit();
+  return 0;
+}